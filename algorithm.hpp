@@ -203,7 +203,7 @@ int alg_single_step_mru(array_as_permutation *perm, memory_perm *mem, unsigned s
     }
 
     alg_cost += item_pos;
-    array_as_permutation explicit_memory = perm_from_index_quadratic(mem->data);
+    array_as_permutation explicit_memory = perm_from_index(mem->data);
     array_as_permutation explicit_memory_inverse = inverse(explicit_memory);
 
     while (item_pos >= 1 && explicit_memory_inverse[(*perm)[item_pos-1]] > explicit_memory_inverse[presented_item]) {
@@ -239,7 +239,7 @@ void alg_single_step_mru_eager_info(array_as_permutation *perm, memory_perm *mem
     alg_cost += item_pos;
     // Compute the position of presented_item, include the search for it in alg_cost.
 
-    permutation<LISTSIZE> mru_memory = permutation<LISTSIZE>::perm_from_index_quadratic(mem->data);
+    permutation<LISTSIZE> mru_memory = permutation<LISTSIZE>::perm_from_index(mem->data);
 
     // Compute the minimum inversion count.
     int min_inversions_val = std::numeric_limits<int>::max();
@@ -275,7 +275,7 @@ int alg_single_step_mru_eager(array_as_permutation *perm, memory_perm *mem, unsi
     alg_cost += item_pos;
     // Compute the position of presented_item, include the search for it in alg_cost.
 
-    permutation<LISTSIZE> mru_memory = permutation<LISTSIZE>::perm_from_index_quadratic(mem->data);
+    permutation<LISTSIZE> mru_memory = permutation<LISTSIZE>::perm_from_index(mem->data);
 
     // Compute the minimum inversion count.
     int min_inversions_val = std::numeric_limits<int>::max();
@@ -336,7 +336,7 @@ int alg_single_step_lessrecent(array_as_permutation *perm, memory_perm *mem, uns
     alg_cost += item_pos;
     // Compute the position of presented_item, include the search for it in alg_cost.
 
-    permutation<LISTSIZE> mru_memory = permutation<LISTSIZE>::perm_from_index_quadratic(mem->data);
+    permutation<LISTSIZE> mru_memory = permutation<LISTSIZE>::perm_from_index(mem->data);
 
     permutation<LISTSIZE> perm_object(*perm);
     // Compute how many elements in the list ahead of presented_item are less recent.
@@ -395,7 +395,7 @@ int alg_single_step_mru_semi_eager(array_as_permutation *perm, memory_perm *mem,
     // Compute the position of presented_item, include the search for it in alg_cost.
 
 
-    permutation<LISTSIZE> mru_memory = permutation<LISTSIZE>::perm_from_index_quadratic(mem->data);
+    permutation<LISTSIZE> mru_memory = permutation<LISTSIZE>::perm_from_index(mem->data);
 
     // Compute the minimum inversion count.
     int min_inversions_val = std::numeric_limits<int>::max();
@@ -467,7 +467,7 @@ int alg_single_step_mru_first_inversion(array_as_permutation *perm, memory_perm
     alg_cost += item_pos;
     // Compute the position of presented_item, include the search for it in alg_cost.
 
-    permutation<LISTSIZE> mru_memory = permutation<LISTSIZE>::perm_from_index_quadratic(mem->data);
+    permutation<LISTSIZE> mru_memory = permutation<LISTSIZE>::perm_from_index(mem->data);
     permutation<LISTSIZE> perm_object(*perm);
 
     int first_inversion_target = item_pos;
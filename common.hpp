@@ -1,5 +1,6 @@
 #pragma once
 #include <array>
+#include <bit>
 #include <cstdint>
 #include <cstdio>
 
@@ -23,6 +24,47 @@ using cost_t = float; // If memory is an issue, you can use this.
 
 constexpr bool ALG_DEBUG = false;
 constexpr bool GRAPH_DEBUG = false;
+
+// How the game graph potentials are iterated until a fixpoint.
+// sweeps: alternating full sweeps over all ADV and all ALG vertices.
+// worklist: the same, but only the vertices whose successors changed potential are re-evaluated.
+// gauss_seidel: a single fused in-place pass per round, work function by work function.
+enum class update_schedule {
+    sweeps,
+    worklist,
+    gauss_seidel
+};
+constexpr update_schedule GRAPH_SCHEDULE = update_schedule::worklist;
+
+// Store the ALG potentials as int8_t offsets (see block_potentials.hpp), which roughly halves the memory
+// of the game graph and of the pairwise one. Not compatible with the gauss_seidel schedule.
+constexpr bool COMPACT_ALG_POTENTIALS = false;
+
+// The game graph tabulates the ALG move costs for list sizes up to this one. The table has
+// factorial[SIZE]^2 * SIZE shorts, which is too much from SIZE=7 on.
+constexpr short ALG_COST_TABLE_MAX_SIZE = 6;
+
+// Store one work function per orbit under relabelings of the list elements, see wf_manager.
+// Not compatible with the worklist schedule.
+constexpr bool CANONICAL_ORBITS = false;
+
+// Look up the reachable work functions by their contents, not just by their 64-bit Zobrist hashes,
+// see exact_wf_table. Without it, two work functions with the same hash are silently taken as one.
+constexpr bool EXACT_WORKFUNCTION_KEYS = true;
+
+// How often a long potential iteration saves a checkpoint it can be resumed from, see wf/checkpoint.hpp.
+// While a checkpoint is written, it holds a copy of the ADV potentials and of the ALG potentials,
+// the latter compact if the graph keeps them compact.
+constexpr int CHECKPOINT_INTERVAL_SECONDS = 1800;
+
+constexpr const char* schedule_name(update_schedule s) {
+    switch (s) {
+        case update_schedule::sweeps: return "sweeps";
+        case update_schedule::worklist: return "worklist";
+        case update_schedule::gauss_seidel: return "gauss-seidel";
+    }
+    return "unknown";
+}
 constexpr bool FRONT_ACCESS_COSTS_ONE = true;
 
 
@@ -77,6 +119,40 @@ constexpr short diameter_bound(short n) {
     return (n*(n-1))/2;
 }
 
-inline bool triple_contains(const std::array<int8_t, 3>* ar, const short el) {
-    return (el == (*ar)[0] || el == (*ar)[1] || el == (*ar)[2]);
+// A set of requests of a list of at most eight elements, one bit per request. Used for the last three
+// maximizers of ADV and for the decisions of OPT.
+using request_set = uint8_t;
+
+inline bool request_set_contains(request_set set, const short el) {
+    return (set >> el) & 1;
+}
+
+// Saves a new maximizer in the last three of an ADV vertex. Once there are three, the new one replaces
+// the (iteration % 3)-th smallest of them. The triples of the older files instead replaced their
+// (iteration % 3)-th slot, even when another slot was free, and the decisions were tried in slot order, while
+// a set tries them in increasing order. The decision search therefore takes other (equally valid) decisions
+// than it did with the triples; game_graph_test pins the ones it takes now.
+inline request_set request_set_save_maximizer(request_set saved, int8_t r, uint64_t iteration_mod_three) {
+    if (request_set_contains(saved, r)) {
+        return saved;
+    }
+    if (std::popcount(saved) == 3) {
+        request_set later = saved;
+        for (uint64_t i = 0; i < iteration_mod_three; i++) {
+            later &= later - 1;
+        }
+        saved &= ~(later & -later);
+    }
+    return saved | (1 << r);
+}
+
+// The older files store a set as three requests, with -1 for an unused one.
+inline request_set request_set_from_triple(const std::array<int8_t, 3>& ar) {
+    request_set set = 0;
+    for (int8_t el : ar) {
+        if (el != -1) {
+            set |= 1 << el;
+        }
+    }
+    return set;
 }
\ No newline at end of file
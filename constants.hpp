@@ -1,6 +1,13 @@
 #pragma once
 #include <string>
 
+// Programs which choose the list size and the ratio at runtime define RUNTIME_SIZE_AND_RATIO.
+// TSIZE is then the largest list size they support, and COMP_RATIO only the default ratio.
+#ifdef RUNTIME_SIZE_AND_RATIO
+#define TSIZE 7
+#define COMP_RATIO 3.0
+#endif
+
 #ifndef COMP_RATIO
 #error "The float macro constant COMP_RATIO must be passed by the compiler."
 #define COMP_RATIO 3.0 // This line is a hack to make G++ spit out only the error above.
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cassert>
+#include <limits>
+#include <numeric>
+#include <vector>
+#include <omp.h>
+
+// A compressed array of potentials. The array is split into blocks of equal size and each block stores
+// its potentials as int8_t offsets from a per-block base. Potentials are additionally divided by a common unit
+// (in the game graph, the gcd of all edge costs), which keeps the offsets small.
+//
+// A write which does not fit into the offset range is not applied immediately; it is marked and remembered,
+// and the block is either rebased or promoted to a full array of shorts in consolidate(). This way, concurrent
+// writes into the same block from several threads are safe, as long as no thread reads a value written
+// since the last consolidate() -- which holds for the sweeps of the game graph, where ALG vertices are only
+// read while ADV vertices are written and vice versa. Each index may be written at most once between
+// two consolidations.
+
+class block_potentials {
+public:
+    static constexpr int8_t OVERFLOW_MARK = std::numeric_limits<int8_t>::min();
+    static constexpr int OFFSET_MAX = std::numeric_limits<int8_t>::max();
+    static constexpr int OFFSET_MIN = -OFFSET_MAX;
+
+    uint64_t size = 0;
+    uint64_t block_size = 0;
+    uint64_t blocks = 0;
+    short unit = 1;
+
+    int8_t* offsets = nullptr;
+    short* bases = nullptr;
+    short** promoted = nullptr;
+    uint64_t promoted_blocks = 0;
+    uint64_t rebased_blocks = 0;
+
+    // Writes which overflowed since the last consolidation, one list per thread. The lists are sized for
+    // omp_get_max_threads() whenever there are no pending writes, in reset() and consolidate(), so a sweep
+    // may run with as many threads as were allowed when the previous one was consolidated.
+    std::vector<std::vector<std::pair<uint64_t, short>>> pending;
+
+    block_potentials(uint64_t sz, uint64_t bsize, short u) : size(sz), block_size(bsize), unit(u) {
+        assert(size % block_size == 0);
+        blocks = size / block_size;
+        offsets = new int8_t[size];
+        bases = new short[blocks];
+        promoted = new short*[blocks];
+        for (uint64_t b = 0; b < blocks; b++) {
+            promoted[b] = nullptr;
+        }
+        reset();
+    }
+
+    ~block_potentials() {
+        for (uint64_t b = 0; b < blocks; b++) {
+            delete[] promoted[b];
+        }
+        delete[] promoted;
+        delete[] bases;
+        delete[] offsets;
+    }
+
+    void reset() {
+        for (uint64_t b = 0; b < blocks; b++) {
+            delete[] promoted[b];
+            promoted[b] = nullptr;
+            bases[b] = 0;
+        }
+        for (uint64_t i = 0; i < size; i++) {
+            offsets[i] = 0;
+        }
+        promoted_blocks = 0;
+        rebased_blocks = 0;
+        for (auto& thread_pending : pending) {
+            thread_pending.clear();
+        }
+        fit_pending();
+    }
+
+    void fit_pending() {
+        if (pending.size() < (uint64_t) omp_get_max_threads()) {
+            pending.resize(omp_get_max_threads());
+        }
+    }
+
+    inline short get(uint64_t index) const {
+        uint64_t b = index / block_size;
+        if (promoted[b] != nullptr) {
+            return promoted[b][index % block_size];
+        }
+        assert(offsets[index] != OVERFLOW_MARK);
+        return (short) ((bases[b] + offsets[index]) * unit);
+    }
+
+    inline void set(uint64_t index, short pot) {
+        uint64_t b = index / block_size;
+        if (promoted[b] != nullptr) {
+            promoted[b][index % block_size] = pot;
+            return;
+        }
+        assert(pot % unit == 0);
+        int offset = pot / unit - bases[b];
+        if (offset >= OFFSET_MIN && offset <= OFFSET_MAX) {
+            offsets[index] = (int8_t) offset;
+        } else {
+            offsets[index] = OVERFLOW_MARK;
+            assert((uint64_t) omp_get_thread_num() < pending.size());
+            pending[omp_get_thread_num()].emplace_back(index, pot);
+        }
+    }
+
+    // Applies the overflowing writes. A block is rebased around the middle of its range if it fits,
+    // and promoted to shorts otherwise. Must not run concurrently with get() or set().
+    void consolidate() {
+        for (auto& thread_pending : pending) {
+            for (auto [index, pot] : thread_pending) {
+                uint64_t b = index / block_size;
+                if (promoted[b] != nullptr) {
+                    promoted[b][index % block_size] = pot;
+                    continue;
+                }
+
+                int lo = pot / unit, hi = pot / unit;
+                for (uint64_t i = b * block_size; i < (b + 1) * block_size; i++) {
+                    if (offsets[i] != OVERFLOW_MARK) {
+                        lo = std::min(lo, bases[b] + offsets[i]);
+                        hi = std::max(hi, bases[b] + offsets[i]);
+                    }
+                }
+
+                if (hi - lo <= OFFSET_MAX - OFFSET_MIN) {
+                    short new_base = (short) (lo + (hi - lo) / 2);
+                    for (uint64_t i = b * block_size; i < (b + 1) * block_size; i++) {
+                        if (offsets[i] != OVERFLOW_MARK) {
+                            offsets[i] = (int8_t) (bases[b] + offsets[i] - new_base);
+                        }
+                    }
+                    bases[b] = new_base;
+                    offsets[index] = (int8_t) (pot / unit - new_base);
+                    rebased_blocks++;
+                } else {
+                    // Other overflowing writes into this block are applied later in this loop.
+                    promoted[b] = new short[block_size];
+                    for (uint64_t i = 0; i < block_size; i++) {
+                        promoted[b][i] = (short) ((bases[b] + offsets[b * block_size + i]) * unit);
+                    }
+                    promoted[b][index % block_size] = pot;
+                    promoted_blocks++;
+                }
+            }
+            thread_pending.clear();
+        }
+        fit_pending();
+    }
+
+    // Makes this array a copy of the other one, which must have the same size and blocks and must be consolidated.
+    void copy_from(const block_potentials& other) {
+        assert(size == other.size && block_size == other.block_size);
+        unit = other.unit;
+        std::copy(other.offsets, other.offsets + size, offsets);
+        std::copy(other.bases, other.bases + blocks, bases);
+        for (uint64_t b = 0; b < blocks; b++) {
+            if (other.promoted[b] == nullptr) {
+                delete[] promoted[b];
+                promoted[b] = nullptr;
+                continue;
+            }
+            if (promoted[b] == nullptr) {
+                promoted[b] = new short[block_size];
+            }
+            std::copy(other.promoted[b], other.promoted[b] + block_size, promoted[b]);
+        }
+        promoted_blocks = other.promoted_blocks;
+        rebased_blocks = other.rebased_blocks;
+    }
+
+    uint64_t memory_bytes() const {
+        return size * sizeof(int8_t) + blocks * (sizeof(short) + sizeof(short*))
+               + promoted_blocks * block_size * sizeof(short);
+    }
+
+    void report(const char* descriptor) const {
+        fprintf(stderr, "Compact %s potentials: %" PRIu64 " MB (%" PRIu64 " MB as shorts), unit %hd, "
+                        "%" PRIu64 " rebased and %" PRIu64 "/%" PRIu64 " promoted blocks.\n",
+                descriptor, memory_bytes() / (1024 * 1024), size * sizeof(short) / (1024 * 1024), unit,
+                rebased_blocks, promoted_blocks, blocks);
+    }
+};
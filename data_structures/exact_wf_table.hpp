@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cinttypes>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "../workfunction.hpp"
+
+// Work functions stored exactly, keyed by a 64-bit hash but compared by content. Each work function is
+// packed into a record of RECORD_WORDS words, VALUE_BITS bits per value, in an arena with one record per index.
+// The index of the hashes is split into shards with a lock each, like sharded_hash_map, and maps a hash
+// to the indices of all records with that hash. A lookup compares the records, so two different
+// work functions with the same hash are told apart; such hash collisions are counted.
+//
+// The arena is sized by the caller, and a record must be stored before its index is inserted. Records with
+// different indices may be stored concurrently, as each record starts at a word boundary.
+
+template <int SIZE> class exact_wf_table {
+public:
+    static constexpr int VALUE_BITS = std::bit_width((unsigned int) diameter_bound(SIZE));
+    static constexpr uint64_t RECORD_WORDS = (factorial[SIZE] * VALUE_BITS + 63) / 64;
+    static constexpr uint64_t NOT_FOUND = UINT64_MAX;
+    using record = std::array<uint64_t, RECORD_WORDS>;
+
+    struct shard {
+        std::mutex lock;
+        std::unordered_multimap<uint64_t, uint64_t> index;
+    };
+
+    int logshards = 0;
+    std::vector<shard> shards;
+    std::vector<uint64_t> arena;
+    std::atomic<uint64_t> collisions{0};
+
+    explicit exact_wf_table(int logsh = 8) : logshards(logsh), shards(1LLU << logsh) {}
+
+    static record pack(const workfunction<SIZE>& wf) {
+        record r{};
+        for (uint64_t i = 0; i < factorial[SIZE]; i++) {
+            const uint64_t bit = i * VALUE_BITS;
+            r[bit / 64] |= (uint64_t) wf.vals[i] << (bit % 64);
+            if (bit % 64 + VALUE_BITS > 64) {
+                r[bit / 64 + 1] |= (uint64_t) wf.vals[i] >> (64 - bit % 64);
+            }
+        }
+        return r;
+    }
+
+    shard& shard_of(uint64_t hash) {
+        return shards[hash >> (64 - logshards)];
+    }
+
+    const shard& shard_of(uint64_t hash) const {
+        return shards[hash >> (64 - logshards)];
+    }
+
+    // The number of records the arena has room for.
+    uint64_t capacity() const {
+        return arena.size() / RECORD_WORDS;
+    }
+
+    void resize(uint64_t records) {
+        arena.resize(records * RECORD_WORDS);
+    }
+
+    void store(uint64_t index, const record& r) {
+        std::copy(r.begin(), r.end(), arena.begin() + index * RECORD_WORDS);
+    }
+
+    record at(uint64_t index) const {
+        record r;
+        std::copy(arena.begin() + index * RECORD_WORDS, arena.begin() + (index + 1) * RECORD_WORDS, r.begin());
+        return r;
+    }
+
+    bool matches(uint64_t index, const record& r) const {
+        return std::equal(r.begin(), r.end(), arena.begin() + index * RECORD_WORDS);
+    }
+
+    // Not synchronized with concurrent insertions.
+    uint64_t find(uint64_t hash, const record& r) const {
+        auto [first, last] = shard_of(hash).index.equal_range(hash);
+        for (auto it = first; it != last; it++) {
+            if (matches(it->second, r)) {
+                return it->second;
+            }
+        }
+        return NOT_FOUND;
+    }
+
+    // Inserts the stored record at the index, which must not be present yet.
+    void insert(uint64_t hash, uint64_t index) {
+        shard& s = shard_of(hash);
+        std::lock_guard<std::mutex> guard(s.lock);
+        if (s.index.contains(hash)) {
+            collisions++;
+        }
+        s.index.emplace(hash, index);
+    }
+
+    // Inserts the stored record at the index, unless the same record is present at a smaller index;
+    // a larger one is replaced. The minimum does not depend on the order of insertions.
+    void insert_min(uint64_t hash, uint64_t index) {
+        shard& s = shard_of(hash);
+        std::lock_guard<std::mutex> guard(s.lock);
+        auto [first, last] = s.index.equal_range(hash);
+        const uint64_t* r = arena.data() + index * RECORD_WORDS;
+        for (auto it = first; it != last; it++) {
+            if (std::equal(r, r + RECORD_WORDS, arena.begin() + it->second * RECORD_WORDS)) {
+                it->second = std::min(it->second, index);
+                return;
+            }
+        }
+        if (first != last) {
+            collisions++;
+        }
+        s.index.emplace(hash, index);
+    }
+
+    uint64_t size() const {
+        uint64_t ret = 0;
+        for (const shard& s : shards) {
+            ret += s.index.size();
+        }
+        return ret;
+    }
+
+    // The arena and an estimate of the index: a node with the key, the value and a pointer per entry,
+    // and a pointer per bucket.
+    uint64_t memory_bytes() const {
+        uint64_t ret = arena.size() * sizeof(uint64_t);
+        for (const shard& s : shards) {
+            ret += s.index.size() * (2 * sizeof(uint64_t) + sizeof(void*)) + s.index.bucket_count() * sizeof(void*);
+        }
+        return ret;
+    }
+
+    void clear() {
+        for (shard& s : shards) {
+            s.index.clear();
+        }
+        collisions = 0;
+    }
+};
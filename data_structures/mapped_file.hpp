@@ -0,0 +1,192 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <array>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../workfunction.hpp"
+
+// A versioned binary layout for the large arrays, which can be memory-mapped and used in place.
+// The file starts with a header and a table of sections, and every section starts at a page boundary.
+// Each section is followed by at least one page of zero padding, so that vectorized kernels may safely read
+// a little past its end, just like past the padded arrays allocated by new.
+//
+// Older files without the header are still read by the fread-based loaders.
+
+constexpr char SECTIONED_FILE_MAGIC[8] = {'L', 'U', 'S', 'E', 'C', 'T', '\0', '\0'};
+constexpr uint32_t SECTIONED_FILE_VERSION = 3;
+constexpr uint32_t SECTIONED_FILE_MAX_SECTIONS = 8;
+constexpr uint64_t SECTIONED_FILE_ALIGNMENT = 4096;
+
+struct sectioned_file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t sections;
+    std::array<uint64_t, SECTIONED_FILE_MAX_SECTIONS> offsets;
+    std::array<uint64_t, SECTIONED_FILE_MAX_SECTIONS> bytes;
+};
+
+static_assert(sizeof(sectioned_file_header) <= SECTIONED_FILE_ALIGNMENT);
+
+inline uint64_t sectioned_file_align(uint64_t x) {
+    return ((x + SECTIONED_FILE_ALIGNMENT - 1) / SECTIONED_FILE_ALIGNMENT) * SECTIONED_FILE_ALIGNMENT;
+}
+
+// Writes a sectioned file. The sizes of all sections must be known in advance; the contents
+// of each section may then be written in several pieces.
+// The file is written under a temporary name and renamed when closed, so that processes which
+// have the previous version mapped keep reading it instead of a truncated file.
+class sectioned_file_writer {
+public:
+    std::string final_filename;
+    std::string temporary_filename;
+    FILE* binary_file = nullptr;
+    sectioned_file_header header{};
+    std::array<uint64_t, SECTIONED_FILE_MAX_SECTIONS> written{};
+    uint64_t total_bytes = 0;
+
+    sectioned_file_writer(const std::string& filename, const std::vector<uint64_t>& section_bytes)
+        : final_filename(filename), temporary_filename(filename + ".tmp") {
+        if (section_bytes.size() > SECTIONED_FILE_MAX_SECTIONS) {
+            PRINT_AND_ABORT("Too many sections for the file %s.\n", filename.c_str());
+        }
+        binary_file = fopen(temporary_filename.c_str(), "wb");
+        if (binary_file == nullptr) {
+            PRINT_AND_ABORT("The file %s could not be opened for writing.\n", filename.c_str());
+        }
+
+        memcpy(header.magic, SECTIONED_FILE_MAGIC, sizeof(header.magic));
+        header.version = SECTIONED_FILE_VERSION;
+        header.sections = section_bytes.size();
+        uint64_t offset = SECTIONED_FILE_ALIGNMENT;
+        for (uint32_t i = 0; i < header.sections; i++) {
+            header.offsets[i] = offset;
+            header.bytes[i] = section_bytes[i];
+            offset = sectioned_file_align(offset + section_bytes[i]) + SECTIONED_FILE_ALIGNMENT;
+        }
+        total_bytes = offset;
+
+        if (fwrite(&header, sizeof(header), 1, binary_file) != 1) {
+            PRINT_AND_ABORT("The header of %s was not written correctly.\n", filename.c_str());
+        }
+    }
+
+    // Appends to the given section.
+    void write(uint32_t section, const void* data, uint64_t bytes) {
+        assert(section < header.sections && written[section] + bytes <= header.bytes[section]);
+        fseeko(binary_file, header.offsets[section] + written[section], SEEK_SET);
+        if (fwrite(data, 1, bytes, binary_file) != bytes) {
+            PRINT_AND_ABORT("Section %" PRIu32 " was not written correctly.\n", section);
+        }
+        written[section] += bytes;
+    }
+
+    void close() {
+        for (uint32_t i = 0; i < header.sections; i++) {
+            if (written[i] != header.bytes[i]) {
+                PRINT_AND_ABORT("Section %" PRIu32 " is incomplete.\n", i);
+            }
+        }
+        fflush(binary_file);
+        // Extends the file by the zero padding of the last section.
+        if (ftruncate(fileno(binary_file), total_bytes) != 0) {
+            PRINT_AND_ABORT("The sectioned file could not be padded.\n");
+        }
+        // The contents must reach the disk before the rename does.
+        fsync(fileno(binary_file));
+        fclose(binary_file);
+        binary_file = nullptr;
+        if (rename(temporary_filename.c_str(), final_filename.c_str()) != 0) {
+            PRINT_AND_ABORT("The file %s could not be renamed.\n", temporary_filename.c_str());
+        }
+    }
+
+    ~sectioned_file_writer() {
+        if (binary_file != nullptr) {
+            close();
+        }
+    }
+};
+
+// A memory-mapped sectioned file. A read-only mapping is shared by all processes which map the same file.
+// A writable mapping is private: the pages are shared until written, and the writes never reach the file.
+class mapped_file {
+public:
+    void* base = nullptr;
+    uint64_t length = 0;
+    sectioned_file_header header{};
+
+    static bool is_sectioned(const std::string& filename) {
+        FILE* f = fopen(filename.c_str(), "rb");
+        if (f == nullptr) {
+            return false;
+        }
+        char magic[8] = {};
+        size_t read = fread(magic, 1, sizeof(magic), f);
+        fclose(f);
+        return read == sizeof(magic) && memcmp(magic, SECTIONED_FILE_MAGIC, sizeof(magic)) == 0;
+    }
+
+    // The advice is passed to madvise(); sequential suits the sweeps, random the reachability searches.
+    mapped_file(const std::string& filename, bool writable, int advice = MADV_SEQUENTIAL) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            PRINT_AND_ABORT("The file %s could not be opened.\n", filename.c_str());
+        }
+        struct stat st{};
+        fstat(fd, &st);
+        length = st.st_size;
+        int prot = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+        base = mmap(nullptr, length, prot, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            PRINT_AND_ABORT("The file %s could not be mapped.\n", filename.c_str());
+        }
+
+        memcpy(&header, base, sizeof(header));
+        if (memcmp(header.magic, SECTIONED_FILE_MAGIC, sizeof(header.magic)) != 0) {
+            PRINT_AND_ABORT("The file %s is not a sectioned file.\n", filename.c_str());
+        }
+        if (header.version != SECTIONED_FILE_VERSION) {
+            PRINT_AND_ABORT("The file %s has version %" PRIu32 ", expected %" PRIu32 ".\n",
+                            filename.c_str(), header.version, SECTIONED_FILE_VERSION);
+        }
+        for (uint32_t i = 0; i < header.sections; i++) {
+            if (header.offsets[i] + header.bytes[i] > length) {
+                PRINT_AND_ABORT("The file %s is truncated.\n", filename.c_str());
+            }
+        }
+        madvise(base, length, advice);
+    }
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    ~mapped_file() {
+        munmap(base, length);
+    }
+
+    uint32_t sections() const {
+        return header.sections;
+    }
+
+    // The number of elements of the given type in the section.
+    template <typename T> uint64_t elements(uint32_t section) const {
+        assert(section < header.sections && header.bytes[section] % sizeof(T) == 0);
+        return header.bytes[section] / sizeof(T);
+    }
+
+    template <typename T> T* section(uint32_t section) const {
+        assert(section < header.sections);
+        return reinterpret_cast<T*>(static_cast<char*>(base) + header.offsets[section]);
+    }
+};
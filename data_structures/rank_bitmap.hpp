@@ -0,0 +1,139 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cinttypes>
+#include <cstdint>
+#include <vector>
+
+// A set of indices below a fixed bound, stored as a bitmap with a rank directory: the number of set bits
+// before each block of RANK_BLOCK_WORDS words. The directory costs an eighth of the bitmap and answers
+// rank() with at most RANK_BLOCK_WORDS popcounts, so the position of an index among the set ones is
+// available without storing the indices themselves.
+//
+// The bitmap is scanned word by word in increasing order, which is how the reachable subgraph of
+// the game graph is iterated. The words and the directory are either owned or point into a mapped file.
+
+class rank_bitmap {
+public:
+    static constexpr uint64_t RANK_BLOCK_WORDS = 8;
+
+    uint64_t bits = 0;
+    uint64_t words = 0;
+    uint64_t blocks = 0;
+    uint64_t* data = nullptr;
+    // blocks + 1 entries, the last one being the number of set bits.
+    uint64_t* block_ranks = nullptr;
+
+    std::vector<uint64_t> owned_data{};
+    std::vector<uint64_t> owned_block_ranks{};
+
+    rank_bitmap() = default;
+    // The words and the directory may point into the owned vectors, which a move keeps in place.
+    rank_bitmap(const rank_bitmap&) = delete;
+    rank_bitmap& operator=(const rank_bitmap&) = delete;
+    rank_bitmap(rank_bitmap&&) = default;
+    rank_bitmap& operator=(rank_bitmap&&) = default;
+
+    static uint64_t words_for(uint64_t bits) {
+        return (bits + 63) / 64;
+    }
+
+    static uint64_t blocks_for(uint64_t bits) {
+        return (words_for(bits) + RANK_BLOCK_WORDS - 1) / RANK_BLOCK_WORDS;
+    }
+
+    // An empty set over [0, n). The ranks are valid only after build_ranks().
+    void allocate(uint64_t n) {
+        bits = n;
+        words = words_for(n);
+        blocks = blocks_for(n);
+        owned_data.assign(words, 0);
+        owned_block_ranks.assign(blocks + 1, 0);
+        data = owned_data.data();
+        block_ranks = owned_block_ranks.data();
+    }
+
+    // Uses the given words and directory, which must outlive the bitmap.
+    void attach(uint64_t n, uint64_t* d, uint64_t* ranks) {
+        release();
+        bits = n;
+        words = words_for(n);
+        blocks = blocks_for(n);
+        data = d;
+        block_ranks = ranks;
+    }
+
+    void release() {
+        owned_data = std::vector<uint64_t>{};
+        owned_block_ranks = std::vector<uint64_t>{};
+        data = nullptr;
+        block_ranks = nullptr;
+        bits = words = blocks = 0;
+    }
+
+    bool empty() const {
+        return data == nullptr;
+    }
+
+    bool contains(uint64_t index) const {
+        assert(index < bits);
+        return (data[index / 64] >> (index % 64)) & 1;
+    }
+
+    void set(uint64_t index) {
+        assert(index < bits);
+        data[index / 64] |= 1LLU << (index % 64);
+    }
+
+    // Sets the bit, also from several threads at once. Returns true if it was not set before.
+    bool insert_atomic(uint64_t index) {
+        assert(index < bits);
+        const uint64_t mask = 1LLU << (index % 64);
+        return (std::atomic_ref<uint64_t>(data[index / 64]).fetch_or(mask, std::memory_order_relaxed) & mask) == 0;
+    }
+
+    void build_ranks() {
+        uint64_t r = 0;
+        for (uint64_t b = 0; b < blocks; b++) {
+            block_ranks[b] = r;
+            const uint64_t last_word = std::min(words, (b + 1) * RANK_BLOCK_WORDS);
+            for (uint64_t w = b * RANK_BLOCK_WORDS; w < last_word; w++) {
+                r += std::popcount(data[w]);
+            }
+        }
+        block_ranks[blocks] = r;
+    }
+
+    // The number of set bits.
+    uint64_t count() const {
+        return block_ranks == nullptr ? 0 : block_ranks[blocks];
+    }
+
+    // The number of set bits before the index.
+    uint64_t rank(uint64_t index) const {
+        assert(index <= bits);
+        const uint64_t word = index / 64;
+        uint64_t r = block_ranks[word / RANK_BLOCK_WORDS];
+        for (uint64_t w = word - word % RANK_BLOCK_WORDS; w < word; w++) {
+            r += std::popcount(data[w]);
+        }
+        if (index % 64 != 0) {
+            r += std::popcount(data[word] & ((1LLU << (index % 64)) - 1));
+        }
+        return r;
+    }
+
+    // Calls f(index) for every set index in increasing order.
+    template <typename F> void for_each(F f) const {
+        for (uint64_t w = 0; w < words; w++) {
+            uint64_t word_bits = data[w];
+            while (word_bits != 0) {
+                f(w * 64 + std::countr_zero(word_bits));
+                word_bits &= word_bits - 1;
+            }
+        }
+    }
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// A hash map from 64-bit hashes to 64-bit values, split into shards with a lock each,
+// so that many threads can insert into it at once. The shard is chosen by the top bits of the hash;
+// the low byte is not used, as the work function hashes have it forced nonzero.
+
+class sharded_hash_map {
+public:
+    struct shard {
+        std::mutex lock;
+        std::unordered_map<uint64_t, uint64_t> map;
+    };
+
+    int logshards = 0;
+    std::vector<shard> shards;
+
+    explicit sharded_hash_map(int logsh = 8) : logshards(logsh), shards(1LLU << logsh) {}
+
+    shard& shard_of(uint64_t hash) {
+        return shards[hash >> (64 - logshards)];
+    }
+
+    const shard& shard_of(uint64_t hash) const {
+        return shards[hash >> (64 - logshards)];
+    }
+
+    // Not synchronized with concurrent insertions.
+    bool contains(uint64_t hash) const {
+        return shard_of(hash).map.contains(hash);
+    }
+
+    void insert(uint64_t hash, uint64_t value) {
+        shard& s = shard_of(hash);
+        std::lock_guard<std::mutex> guard(s.lock);
+        s.map[hash] = value;
+    }
+
+    // Stores the value under the hash, unless a smaller value is already stored there.
+    // The minimum does not depend on the order of insertions.
+    void insert_min(uint64_t hash, uint64_t value) {
+        shard& s = shard_of(hash);
+        std::lock_guard<std::mutex> guard(s.lock);
+        auto [it, inserted] = s.map.try_emplace(hash, value);
+        if (!inserted && value < it->second) {
+            it->second = value;
+        }
+    }
+
+    // Not synchronized with concurrent insertions. The hash must be present.
+    uint64_t at(uint64_t hash) const {
+        return shard_of(hash).map.at(hash);
+    }
+
+    uint64_t size() const {
+        uint64_t ret = 0;
+        for (const shard& s : shards) {
+            ret += s.map.size();
+        }
+        return ret;
+    }
+
+    void clear() {
+        for (shard& s : shards) {
+            s.map.clear();
+        }
+    }
+};
@@ -0,0 +1,522 @@
+#include <cstdlib>
+#include <cstdio>
+#include <random>
+#include <unistd.h>
+#include <unordered_set>
+#include "permutation_graph.hpp"
+#include "wf_manager.hpp"
+#include "workfunction.hpp"
+#include "wf/game_graph.hpp"
+#include "wf/checkpoint.hpp"
+
+// Checks, in order:
+// - the vectorized ADV kernels compute the same potentials as update_adv();
+// - the ALG cost table agrees with alg_cost();
+// - the game graph over canonical orbits reaches the same fixpoint as the full one;
+// - the sweeps, the worklist and the Gauss-Seidel schedules reach the same potentials;
+// - the binary files load back through mmap unchanged;
+// - an iteration resumed from a checkpoint, full or compact, reaches the same potentials;
+// - the reachable bitmaps rank their vertices and load back from the current and the older files;
+// - the parallel reachability search finds the same vertices as a serial one;
+// - the last three maximizers are replaced as request_set_save_maximizer() documents;
+// - a decision branch evaluated on its own potentials agrees with the fixpoint over the graph.
+// - the decision search takes the pinned decisions for the test size;
+// - the concurrent search over the choices of a decision picks the same one as a sequential search.
+
+template <short SIZE> bool compare_kernel(game_graph<SIZE>& g, adv_block_kernel<SIZE> kernel, const char* name) {
+    uint64_t mismatches = 0;
+    std::array<short, factorial[SIZE]> new_pots;
+    for (uint64_t wf_index = 0; wf_index < g.wf.reachable_workfunctions; wf_index++) {
+        std::array<const short*, SIZE> sources;
+        std::array<short, SIZE> costs;
+        for (int r = 0; r < SIZE; r++) {
+            sources[r] = g.alg_vertices + g.encode_alg(g.wf.adjacency(wf_index, r), 0, r);
+            costs[r] = g.adv_cost(wf_index, r);
+        }
+        kernel(sources, costs, new_pots.data());
+        for (uint64_t perm_index = 0; perm_index < factorial[SIZE]; perm_index++) {
+            if (new_pots[perm_index] != g.adv_vertices[g.encode_adv(wf_index, perm_index)]) {
+                mismatches++;
+            }
+        }
+    }
+    fprintf(stderr, "Kernel %s: %" PRIu64 " mismatches.\n", name, mismatches);
+    return mismatches == 0;
+}
+
+template <short SIZE> bool compare_alg_cost_table(game_graph<SIZE>& g) {
+    short* table = g.alg_cost_table;
+    if (table == nullptr) {
+        return true;
+    }
+    uint64_t mismatches = 0;
+    for (uint64_t perm_from = 0; perm_from < factorial[SIZE]; perm_from++) {
+        for (short req = 0; req < SIZE; req++) {
+            for (uint64_t perm_to = 0; perm_to < factorial[SIZE]; perm_to++) {
+                g.alg_cost_table = nullptr;
+                short computed = g.alg_cost(perm_from, perm_to, req);
+                g.alg_cost_table = table;
+                if (computed != g.alg_cost(perm_from, perm_to, req)) {
+                    mismatches++;
+                }
+            }
+        }
+    }
+    fprintf(stderr, "ALG cost table: %" PRIu64 " mismatches.\n", mismatches);
+    return mismatches == 0;
+}
+
+template <short SIZE> uint64_t fixpoint(game_graph<SIZE>& g, uint64_t max_iterations = UINT64_MAX,
+                                        bool from_zero = true) {
+    if (from_zero) {
+        g.reset_potentials();
+    }
+    uint64_t iterations = 0;
+    bool anything_updated = true;
+    while (anything_updated && g.min_adv_potential() <= 0 && iterations < max_iterations) {
+        bool adv_updated = g.update_adv();
+        bool alg_updated = g.update_alg_request_moves_forward();
+        anything_updated = adv_updated || alg_updated;
+        iterations++;
+    }
+    return iterations;
+}
+
+template <short SIZE> bool compare_canonical_orbits(wf_manager<SIZE>& wm, game_graph<SIZE>& g) {
+    pg->populate_composition();
+    wf_manager<SIZE> cwm(*pg, true);
+    cwm.initialize_reachable_from_scratch();
+    game_graph<SIZE> cg(cwm, true);
+    uint64_t iterations = fixpoint<SIZE>(g);
+    uint64_t canonical_iterations = fixpoint<SIZE>(cg);
+
+    uint64_t mismatches = 0;
+    uint64_t skipped = 0;
+    for (uint64_t wf_index = 0; wf_index < wm.reachable_workfunctions; wf_index++) {
+        const workfunction<SIZE>* w = &wm.reachable_wfs_arr[wf_index];
+        uint64_t relabeling = cwm.canonical_relabeling(w);
+        workfunction<SIZE> rep = cwm.right_composition(w, relabeling);
+        // Only the representatives reached from the initial work function are stored.
+        uint64_t rep_index = cwm.index_of(&rep);
+        if (rep_index == wf_manager<SIZE>::NOT_REACHABLE) {
+            skipped++;
+            continue;
+        }
+        for (uint64_t perm_index = 0; perm_index < factorial[SIZE]; perm_index++) {
+            uint64_t relabeled_perm = pg->quick_compose_right(relabeling, perm_index);
+            if (g.adv_vertices[g.encode_adv(wf_index, perm_index)] !=
+                cg.adv_vertices[cg.encode_adv(rep_index, relabeled_perm)]) {
+                mismatches++;
+            }
+        }
+    }
+    fprintf(stderr, "Canonical orbits: %" PRIu64 " of %" PRIu64 " work functions, %" PRIu64 " vs %" PRIu64
+            " iterations, %" PRIu64 " skipped, %" PRIu64 " mismatches.\n", cwm.reachable_workfunctions,
+            wm.reachable_workfunctions, canonical_iterations, iterations, skipped, mismatches);
+    return mismatches == 0;
+}
+
+// Runs every update_schedule from zero on the same graph, as potentials_stabilize() does for the one
+// selected by GRAPH_SCHEDULE, and reports the number of rounds each of them takes.
+template <short SIZE> bool compare_schedules(wf_manager<SIZE>& wm) {
+    game_graph<SIZE> g(wm, false);
+    uint64_t sweeps_rounds = fixpoint<SIZE>(g);
+    std::vector<short> sweeps, worklist, gauss_seidel;
+    g.save_potentials(sweeps);
+
+    g.init_worklist(alg_moves::request_moves_forward);
+    g.reset_potentials();
+    uint64_t worklist_rounds = 0;
+    bool anything_updated = true;
+    while (anything_updated && g.min_adv_potential() <= 0) {
+        bool adv_updated = g.worklist_update_adv();
+        bool alg_updated = g.worklist_update_alg();
+        anything_updated = adv_updated || alg_updated;
+        worklist_rounds++;
+    }
+    g.save_potentials(worklist);
+
+    g.reset_potentials();
+    uint64_t gauss_seidel_rounds = 0;
+    anything_updated = true;
+    while (anything_updated && g.min_adv_potential() <= 0) {
+        anything_updated = g.gauss_seidel_update();
+        gauss_seidel_rounds++;
+    }
+    g.save_potentials(gauss_seidel);
+
+    uint64_t mismatches = 0;
+    for (uint64_t i = 0; i < sweeps.size(); i++) {
+        mismatches += (sweeps[i] != worklist[i]) + (sweeps[i] != gauss_seidel[i]);
+    }
+    fprintf(stderr, "Schedules: %" PRIu64 " %s, %" PRIu64 " %s and %" PRIu64 " %s rounds, %" PRIu64
+            " mismatches.\n", sweeps_rounds, schedule_name(update_schedule::sweeps), worklist_rounds,
+            schedule_name(update_schedule::worklist), gauss_seidel_rounds,
+            schedule_name(update_schedule::gauss_seidel), mismatches);
+    return mismatches == 0;
+}
+
+// The files are written under names of their own, so that the test does not depend on the files
+// in the working directory, which may be in an older format.
+template <short SIZE> bool compare_mapped_reload(wf_manager<SIZE>& wm, game_graph<SIZE>& g) {
+    const std::string suffix = std::to_string(SIZE) + "-" + std::to_string(getpid()) + ".bin";
+    const std::string reachable_filename = std::filesystem::temp_directory_path() / ("wfs-reachable-test-" + suffix);
+    const std::string graph_filename = std::filesystem::temp_directory_path() / ("game-graph-test-" + suffix);
+    wm.serialize_reachable(reachable_filename);
+    g.write_graph_binary(graph_filename);
+
+    uint64_t mismatches = 0;
+    wf_manager<SIZE> mapped_wm(*pg);
+    mapped_wm.deserialize_reachable(reachable_filename);
+    if (mapped_wm.reachable_mapping == nullptr || mapped_wm.reachable_workfunctions != wm.reachable_workfunctions ||
+        memcmp(mapped_wm.reachable_wfs_arr, wm.reachable_wfs_arr,
+               wm.reachable_workfunctions * sizeof(workfunction<SIZE>)) != 0 ||
+        memcmp(mapped_wm.adjacent_functions_arr, wm.adjacent_functions_arr,
+               wm.reachable_workfunctions * sizeof(std::array<unsigned int, SIZE>)) != 0) {
+        mismatches++;
+    }
+
+    game_graph<SIZE> mapped(wm, false, graph_filename);
+    game_graph<SIZE> compact(wm, false, graph_filename, true);
+    if (mapped.graph_mapping == nullptr) {
+        mismatches++;
+    }
+    for (uint64_t i = 0; i < g.advsize; i++) {
+        mismatches += mapped.adv_vertices[i] != g.adv_vertices[i];
+        mismatches += compact.adv_vertices[i] != g.adv_vertices[i];
+    }
+    for (uint64_t i = 0; i < g.algsize; i++) {
+        mismatches += mapped.alg_vertices[i] != g.alg_vertices[i];
+        mismatches += compact.alg_potential(i) != g.alg_vertices[i];
+    }
+    // The mapping is private, so updating the potentials must not touch the file.
+    mapped.adv_vertices[0]++;
+    game_graph<SIZE> reloaded(wm, false, graph_filename);
+    mismatches += reloaded.adv_vertices[0] != g.adv_vertices[0];
+
+    std::filesystem::remove(graph_filename);
+    std::filesystem::remove(reachable_filename);
+    fprintf(stderr, "Mapped reload: %" PRIu64 " mismatches.\n", mismatches);
+    return mismatches == 0;
+}
+
+// Probes the ratios of a ratio search from the feasible potentials of the previous probe, as ratio_search()
+// does, on a graph with compact ALG potentials and on one without. The compact unit is fixed for the first ratio,
+// so later ratios make the graph re-encode its potentials.
+template <short SIZE> bool compare_compact_ratio_search(wf_manager<SIZE>& wm) {
+    game_graph<SIZE> full(wm, false);
+    game_graph<SIZE> compact(wm, false, "", true);
+    fixpoint<SIZE>(full);
+    fixpoint<SIZE>(compact);
+    const short first_unit = compact.alg_compact->unit;
+
+    uint64_t mismatches = 0;
+    std::vector<short> start, full_pots, compact_pots;
+    full.save_potentials(start);
+    for (long double probe : {RATIO - 0.01L, RATIO + 0.04L, RATIO + 0.01L}) {
+        full.set_ratio(probe);
+        compact.set_ratio(probe);
+        full.load_potentials(start);
+        compact.load_potentials(start);
+        fixpoint<SIZE>(full, UINT64_MAX, false);
+        fixpoint<SIZE>(compact, UINT64_MAX, false);
+        full.save_potentials(full_pots);
+        compact.save_potentials(compact_pots);
+        for (uint64_t i = 0; i < full_pots.size(); i++) {
+            mismatches += full_pots[i] != compact_pots[i];
+        }
+        if (full.min_adv_potential() <= 0) {
+            start = full_pots;
+        }
+    }
+    fprintf(stderr, "Compact ratio search: unit %hd, then %hd, %" PRIu64 " mismatches.\n",
+            first_unit, compact.alg_compact->unit, mismatches);
+    return mismatches == 0;
+}
+
+// The interrupted graph may keep its ALG potentials compact, which the checkpoint copies in that form.
+template <short SIZE> bool compare_checkpoint_resume(wf_manager<SIZE>& wm, game_graph<SIZE>& g, bool compact) {
+    const std::string filename = std::filesystem::temp_directory_path() /
+        ("checkpoint-test-" + std::to_string(SIZE) + "-" + std::to_string(getpid()) + ".bin");
+    constexpr uint64_t interrupted_after = 5;
+    uint64_t iterations = fixpoint<SIZE>(g);
+    std::vector<short> expected;
+    g.save_potentials(expected);
+
+    game_graph<SIZE> interrupted(wm, false, "", compact);
+    interrupted.init_last_three();
+    fixpoint<SIZE>(interrupted, interrupted_after);
+    {
+        potential_checkpoint<SIZE> checkpoint(filename, std::chrono::seconds(0));
+        checkpoint.save(interrupted, interrupted_after);
+    }
+
+    game_graph<SIZE> resumed(wm, false);
+    uint64_t next_round = potential_checkpoint<SIZE>::resume(resumed, filename);
+    uint64_t resumed_iterations = fixpoint<SIZE>(resumed, UINT64_MAX, false);
+    std::vector<short> actual;
+    resumed.save_potentials(actual);
+    std::filesystem::remove(filename);
+
+    uint64_t mismatches = (next_round != interrupted_after) + (resumed.last_three_maximizers == nullptr);
+    for (uint64_t i = 0; i < expected.size(); i++) {
+        mismatches += expected[i] != actual[i];
+    }
+    fprintf(stderr, "Checkpoint%s: %" PRIu64 " iterations vs %" PRIu64 " + %" PRIu64 " resumed, %" PRIu64
+            " mismatches.\n", compact ? " (compact)" : "", iterations, next_round, resumed_iterations, mismatches);
+    return mismatches == 0;
+}
+
+template <short SIZE> bool compare_reachable_bitmaps(game_graph<SIZE>& g) {
+    const std::string filename = std::filesystem::temp_directory_path() /
+        ("reachable-test-" + std::to_string(SIZE) + "-" + std::to_string(getpid()) + ".bin");
+    std::mt19937 gen(7);
+    std::unordered_set<uint64_t> adv_set, alg_set;
+    for (uint64_t i = 0; i < g.advsize; i++) {
+        if (gen() % 5 == 0) {
+            adv_set.insert(i);
+        }
+    }
+    for (uint64_t i = 0; i < g.algsize; i++) {
+        if (gen() % 3 == 0) {
+            alg_set.insert(i);
+        }
+    }
+    g.reinitialize_reachable_arrays(adv_set, alg_set);
+
+    uint64_t mismatches = (g.reachable_advsize != adv_set.size()) + (g.reachable_algsize != alg_set.size());
+    uint64_t rank = 0;
+    for (uint64_t i = 0; i < g.advsize; i++) {
+        mismatches += g.adv_reachable.rank(i) != rank;
+        mismatches += g.adv_reachable.contains(i) != adv_set.contains(i);
+        rank += adv_set.contains(i);
+    }
+
+    // The older index list, written as by the fread-based loader.
+    std::vector<uint64_t> adv_indices(adv_set.begin(), adv_set.end());
+    std::vector<uint64_t> alg_indices(alg_set.begin(), alg_set.end());
+    FILE* legacy = fopen(filename.c_str(), "wb");
+    uint64_t count = adv_indices.size();
+    fwrite(&count, sizeof(uint64_t), 1, legacy);
+    fwrite(adv_indices.data(), sizeof(uint64_t), count, legacy);
+    count = alg_indices.size();
+    fwrite(&count, sizeof(uint64_t), 1, legacy);
+    fwrite(alg_indices.data(), sizeof(uint64_t), count, legacy);
+    fclose(legacy);
+
+    for (int format = 0; format < 2; format++) {
+        if (format == 1) {
+            g.serialize_reachable_arrays(filename);
+        }
+        game_graph<SIZE> loaded(g.wf, false);
+        loaded.deserialize_reachable_arrays(filename);
+        mismatches += (loaded.reachable_mapping != nullptr) != (format == 1);
+        mismatches += loaded.reachable_advsize != g.reachable_advsize;
+        mismatches += loaded.reachable_algsize != g.reachable_algsize;
+        mismatches += memcmp(loaded.adv_reachable.data, g.adv_reachable.data, g.adv_reachable.words * sizeof(uint64_t)) != 0;
+        mismatches += memcmp(loaded.alg_reachable.data, g.alg_reachable.data, g.alg_reachable.words * sizeof(uint64_t)) != 0;
+        mismatches += loaded.alg_reachable.rank(g.algsize) != g.reachable_algsize;
+    }
+    std::filesystem::remove(filename);
+    g.free_reachable_arrays();
+
+    fprintf(stderr, "Reachable bitmaps: %" PRIu64 " of %" PRIu64 " ADV vertices, %" PRIu64 " mismatches.\n",
+            adv_set.size(), g.advsize, mismatches);
+    return mismatches == 0;
+}
+
+template <short SIZE> bool compare_reachable_traversal(game_graph<SIZE>& g) {
+    g.build_wfa_minima();
+    g.init_last_three();
+    std::mt19937 gen(11);
+    for (uint64_t i = 0; i < g.advsize; i++) {
+        for (int j = 0; j < 2; j++) {
+            g.last_three_maximizers[i] |= 1 << (gen() % SIZE);
+        }
+    }
+    g.wfa_reachable_via(true);
+
+    std::unordered_set<uint64_t> adv_seen{0}, alg_seen{};
+    std::vector<uint64_t> stack{0};
+    while (!stack.empty()) {
+        uint64_t adv_index = stack.back();
+        stack.pop_back();
+        auto [wf_index, perm_index] = g.decode_adv(adv_index);
+        for (int8_t r = 0; r < SIZE; r++) {
+            uint64_t alg_index = g.adv_move(wf_index, perm_index, r);
+            if (!request_set_contains(g.last_three_maximizers[adv_index], r) || !alg_seen.insert(alg_index).second) {
+                continue;
+            }
+            auto [alg_wf_index, alg_perm_index, req] = g.decode_alg(alg_index);
+            const unsigned int minimum = g.wfa_minimum_values[g.encode_adv(alg_wf_index, alg_perm_index)];
+            for (int p = 0; p < factorial[SIZE]; p++) {
+                uint64_t target_adv = g.encode_adv(alg_wf_index, p);
+                if (g.wfa_cost(alg_wf_index, alg_perm_index, p) == minimum && adv_seen.insert(target_adv).second) {
+                    stack.push_back(target_adv);
+                }
+            }
+        }
+    }
+
+    uint64_t mismatches = (g.reachable_advsize != adv_seen.size()) + (g.reachable_algsize != alg_seen.size());
+    for (uint64_t adv_index : adv_seen) {
+        mismatches += !g.adv_reachable.contains(adv_index);
+    }
+    for (uint64_t alg_index : alg_seen) {
+        mismatches += !g.alg_reachable.contains(alg_index);
+    }
+    fprintf(stderr, "Reachable traversal: %" PRIu64 " ADV and %" PRIu64 " ALG vertices, %" PRIu64 " mismatches.\n",
+            g.reachable_advsize, g.reachable_algsize, mismatches);
+
+    // Following the OPT decisions right after the last three starts every vertex at the decision {0}.
+    g.wfa_reachable_via(false);
+    mismatches += g.opt_decisions.size() != g.reachable_advsize;
+    g.free_reachable_arrays();
+    g.free_last_three();
+    return mismatches == 0;
+}
+
+// The replacement policy of the last three maximizers, on which the decision search depends.
+bool compare_save_maximizer() {
+    const request_set full = 0b1110;
+    uint64_t mismatches = 0;
+    mismatches += request_set_save_maximizer(full, 0, 0) != 0b1101;
+    mismatches += request_set_save_maximizer(full, 0, 1) != 0b1011;
+    mismatches += request_set_save_maximizer(full, 0, 2) != 0b0111;
+    mismatches += request_set_save_maximizer(full, 2, 1) != full;
+    mismatches += request_set_save_maximizer(0b0010, 3, 1) != 0b1010;
+    fprintf(stderr, "Save maximizer: %" PRIu64 " mismatches.\n", mismatches);
+    return mismatches == 0;
+}
+
+// The concurrent search over the choices of a decision must pick the same choice as trying them one by one.
+// The branches are synthetic: for every number of choices and every set of winning ones, each branch takes
+// the longer the earlier its choice is, so that later winners finish first and earlier losers get cancelled.
+template <short SIZE> bool compare_concurrent_choices() {
+    uint64_t searches = 0, cancelled_branches = 0, mismatches = 0;
+    for (int choice_count = 1; choice_count <= SIZE; choice_count++) {
+        for (uint32_t winning = 0; winning < (1U << choice_count); winning++) {
+            std::atomic<uint64_t> cancellations{0};
+            int winner = game_graph<SIZE>::first_winner_among(choice_count, [&](int i, auto cancelled) {
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(2 * (choice_count - i));
+                while (std::chrono::steady_clock::now() < deadline) {
+                    if (cancelled()) {
+                        cancellations++;
+                        return false;
+                    }
+                }
+                return ((winning >> i) & 1) == 1;
+            });
+            const int sequential = winning == 0 ? choice_count : std::countr_zero(winning);
+            mismatches += winner != sequential;
+            cancelled_branches += cancellations;
+            searches++;
+        }
+    }
+    fprintf(stderr, "Concurrent choices: %" PRIu64 " searches, %" PRIu64 " cancelled branches, %" PRIu64
+            " mismatches.\n", searches, cancelled_branches, mismatches);
+    return mismatches == 0;
+}
+
+// The decisions come from the last three maximizers at a ratio for which ADV wins against WFA.
+template <short SIZE> bool compare_decision_branches(game_graph<SIZE>& g) {
+    constexpr long double losing_ratio = 2.0;
+    g.set_ratio(losing_ratio);
+    g.reset_potentials();
+    g.init_last_three();
+    bool anything_updated = true;
+    for (uint64_t iteration = 0; anything_updated && g.min_adv_potential() <= 0; iteration++) {
+        bool adv_updated = g.update_adv_save_last_three(iteration);
+        bool alg_updated = g.update_alg_wfa_faster();
+        anything_updated = adv_updated || alg_updated;
+    }
+    g.wfa_reachable_via(true);
+    g.build_decision_map();
+
+    uint64_t branches = 0, opt_wins = 0, mismatches = 0;
+    g.build_decision_subgraph();
+    g.adv_reachable.for_each([&](uint64_t index) {
+        const request_set decision = g.opt_decision(index);
+        for (int8_t r = 0; r < SIZE; r++) {
+            if (!request_set_contains(decision, r)) {
+                continue;
+            }
+            bool branch_wins = g.opt_wins_with_decision(index, r, [] { return false; });
+            g.opt_decision(index) = 1 << r;
+            mismatches += branch_wins != g.opt_wins_via_decisions();
+            g.opt_decision(index) = decision;
+            opt_wins += branch_wins;
+            branches++;
+        }
+    });
+
+    // The decisions found by the search must still let OPT win. For the test size, they are pinned,
+    // as they depend on the order in which the decisions are tried, see request_set_save_maximizer().
+    const int decisions = g.lowerbound_via_decisions();
+    mismatches += !g.opt_wins_via_decisions();
+    uint64_t fingerprint = 14695981039346656037LLU;
+    for (request_set decision : g.opt_decisions) {
+        fingerprint = (fingerprint ^ decision) * 1099511628211LLU;
+    }
+    fprintf(stderr, "Decision search: %d decisions, fingerprint %" PRIx64 ".\n", decisions, fingerprint);
+    if (SIZE == 4) {
+        mismatches += decisions != 120 || fingerprint != 0x5ac9e68f6cb3435aLLU;
+    }
+
+    fprintf(stderr, "Decision branches: %" PRIu64 " branches, OPT wins %" PRIu64 ", %" PRIu64 " mismatches.\n",
+            branches, opt_wins, mismatches);
+    g.free_reachable_arrays();
+    g.free_last_three();
+    g.opt_decisions.clear();
+    g.set_ratio(RATIO);
+    return mismatches == 0;
+}
+
+int main(void) {
+    std::string workfunctions_binary_filename = std::string("wfs-reachable-") + std::to_string(LISTSIZE) +
+        std::string(".bin");
+
+    pg = new permutation_graph<LISTSIZE>();
+    pg->init();
+    invs = new workfunction<LISTSIZE>{};
+    wf_manager<LISTSIZE>::initialize_inversions();
+    pg->populate_quick_inversions();
+
+    wf_manager<TESTSIZE> wm(*pg);
+    wm.initialize_reachable(workfunctions_binary_filename);
+    game_graph<TESTSIZE> g(wm, true);
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<short> dist(-3000, 3000);
+    for (uint64_t i = 0; i < g.algsize; i++) {
+        g.alg_vertices[i] = dist(gen);
+    }
+    g.update_adv();
+
+    bool ok = compare_kernel<TESTSIZE>(g, adv_block_scalar<TESTSIZE>, "scalar");
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        ok &= compare_kernel<TESTSIZE>(g, adv_block_avx2<TESTSIZE>, "avx2");
+    }
+    if (__builtin_cpu_supports("avx512f")) {
+        ok &= compare_kernel<TESTSIZE>(g, adv_block_avx512<TESTSIZE>, "avx512");
+    }
+#endif
+
+    ok &= compare_alg_cost_table<TESTSIZE>(g);
+    ok &= compare_canonical_orbits<TESTSIZE>(wm, g);
+    ok &= compare_schedules<TESTSIZE>(wm);
+    ok &= compare_mapped_reload<TESTSIZE>(wm, g);
+    ok &= compare_compact_ratio_search<TESTSIZE>(wm);
+    ok &= compare_checkpoint_resume<TESTSIZE>(wm, g, false);
+    ok &= compare_checkpoint_resume<TESTSIZE>(wm, g, true);
+    ok &= compare_reachable_bitmaps<TESTSIZE>(g);
+    ok &= compare_reachable_traversal<TESTSIZE>(g);
+    ok &= compare_save_maximizer();
+    ok &= compare_decision_branches<TESTSIZE>(g);
+    ok &= compare_concurrent_choices<TESTSIZE>();
+
+    fprintf(stderr, "Selected kernel: %s.\n", g.adv_kernel_name);
+    return ok ? 0 : 1;
+}
@@ -25,7 +25,7 @@ public:
 
     adversary_vertex *get_vert(array_as_permutation *perm, MEMORY m) const
     {
-        return verts[lexindex_quadratic(perm)][m.data];
+        return verts[lexindex(perm)][m.data];
     }
 
     adversary_vertex *get_vert(long int id);
@@ -85,7 +85,7 @@ public:
     adversary_vertex(array_as_permutation *p, MEMORY m) {
         perm = *p;
         mem = m;
-        id = lexindex_quadratic(&perm) * (MEMORY::max + 1) + mem.data;
+        id = lexindex(&perm) * (MEMORY::max + 1) + mem.data;
     }
 
     inline int position(short item) const {
@@ -166,7 +166,7 @@ void adv_outedge::print(FILE* f) {
 
 void add_vertex_to_graph(array_as_permutation *perm, MEMORY m) {
     auto *v = new adversary_vertex(perm, m);
-    g.verts[lexindex_quadratic(perm)][m.data] = v;
+    g.verts[lexindex(perm)][m.data] = v;
 }
 
 
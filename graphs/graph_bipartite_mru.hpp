@@ -66,7 +66,7 @@ public:
     }
 
     gbm_adversary_vertex *get_adv_vert(array_as_permutation *perm, memory_perm m) const {
-        return adv_verts[adv_index(lexindex_quadratic(perm), m.data)];
+        return adv_verts[adv_index(lexindex(perm), m.data)];
     }
 
     gbm_adversary_vertex *get_adv_vert(uint64_t id) {
@@ -257,14 +257,14 @@ void gbm_alg_outedge::print(FILE *f = stderr) const {
 }
 
 void graph_bipartite_mru::add_adv_vertex(array_as_permutation *perm, MEMORY m) {
-    uint64_t adv_index = graph_bipartite_mru::adv_index(lexindex_quadratic(perm), m.data);
+    uint64_t adv_index = graph_bipartite_mru::adv_index(lexindex(perm), m.data);
     auto *v = new gbm_adversary_vertex(perm, m, adv_index);
     adv_verts[adv_index] = v;
 }
 
 
 void graph_bipartite_mru::add_alg_vertex(array_as_permutation *perm, memory_perm m, short req) {
-    uint64_t alg_index = graph_bipartite_mru::alg_index(lexindex_quadratic(perm), m.data, req);
+    uint64_t alg_index = graph_bipartite_mru::alg_index(lexindex(perm), m.data, req);
     auto *v = new gbm_algorithm_vertex(perm, m, req, alg_index);
     alg_verts[alg_index] = v;
 }
@@ -457,7 +457,7 @@ void graph_bipartite_mru::add_all_outedges(gbm_adversary_vertex *from) {
             array_as_permutation perm_after_relabel(from->perm);
             memory_perm mem_after_relabel = from->mem.recompute(&(opt_relabeling.data));
             recompute_alg_perm(&perm_after_relabel, &(opt_relabeling.data));
-            uint64_t target_alg_id = alg_index(lexindex_quadratic(&perm_after_relabel), mem_after_relabel.data, newreq);
+            uint64_t target_alg_id = alg_index(lexindex(&perm_after_relabel), mem_after_relabel.data, newreq);
             gbm_algorithm_vertex *target = get_alg_vert(target_alg_id);
             add_adv_outedge(from, target, newreq, (cost_t) (newreq + opt_relabeling.inversions()));
 
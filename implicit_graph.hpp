@@ -15,7 +15,7 @@ public:
         uint64_t memory_section = vertex % (MEMORY::max + 1);
         uint64_t permutation_section = vertex / (MEMORY::max + 1);
         MEMORY ret2; ret2.data = memory_section;
-        array_as_permutation ret1 = perm_from_index_quadratic(permutation_section);
+        array_as_permutation ret1 = perm_from_index(permutation_section);
         return {ret1, ret2};
     }
 
@@ -23,7 +23,7 @@ public:
 
         int alg_cost = ALG_SINGLE_STEP(&v_perm, &v_mem, presented_item); // v_perm will get edited.
         int opt_cost = presented_item;
-        long int target = lexindex_quadratic(&v_perm) * (MEMORY::max + 1) + v_mem.data;
+        long int target = lexindex(&v_perm) * (MEMORY::max + 1) + v_mem.data;
         return {target, EDGE_WEIGHT(opt_cost, alg_cost)};
     }
 
@@ -34,7 +34,7 @@ public:
 
         MEMORY mem_copy = v_mem.recompute(&single_swap);
         recompute_alg_perm(&v_perm, &single_swap);
-        long int target = lexindex_quadratic(&v_perm) * (MEMORY::max + 1) + mem_copy.data;
+        long int target = lexindex(&v_perm) * (MEMORY::max + 1) + mem_copy.data;
         return {target, EDGE_WEIGHT(1, 0)};
     }
 
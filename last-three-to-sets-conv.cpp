@@ -0,0 +1,81 @@
+#include <string>
+#include <filesystem>
+#include <array>
+#include <vector>
+#include <cinttypes>
+
+#include "data_structures/mapped_file.hpp"
+
+// Converts the last three maximizers and the decisions from three int8_t requests per ADV vertex
+// to one request_set per ADV vertex. Both the sectioned last three files and the older ones
+// with an ADVSIZE header are read; the result is always sectioned, so it can be mapped.
+//
+// Compile with the same TSIZE and COMP_RATIO as the files, after renaming them to end with ".int8t";
+// the converted files get the names the programs look for.
+
+std::vector<request_set> to_sets(const std::array<int8_t, 3>* triples, uint64_t count) {
+    std::vector<request_set> sets(count);
+    for (uint64_t i = 0; i < count; i++) {
+        sets[i] = request_set_from_triple(triples[i]);
+    }
+    fprintf(stderr, "0: %" PRIi8 ", %" PRIi8 ", %" PRIi8 " -> %" PRIu8 ".\n",
+        triples[0][0], triples[0][1], triples[0][2], sets[0]);
+    return sets;
+}
+
+void convert_last_three(const std::string& old_filename, const std::string& new_filename) {
+    std::vector<request_set> sets;
+    if (mapped_file::is_sectioned(old_filename)) {
+        mapped_file old_file(old_filename, false);
+        const uint64_t advsize = old_file.elements<std::array<int8_t, 3>>(0);
+        sets = to_sets(old_file.section<std::array<int8_t, 3>>(0), advsize);
+    } else {
+        FILE* binary_file = fopen(old_filename.c_str(), "rb");
+        uint64_t advsize = 0;
+        if (fread(&advsize, sizeof(uint64_t), 1, binary_file) != 1) {
+            PRINT_AND_ABORT("ADVSIZE was not read correctly.");
+        }
+        std::vector<std::array<int8_t, 3>> triples(advsize);
+        if (fread(triples.data(), sizeof(std::array<int8_t, 3>), advsize, binary_file) != advsize) {
+            PRINT_AND_ABORT("The last three choices array was not read correctly.");
+        }
+        fclose(binary_file);
+        sets = to_sets(triples.data(), advsize);
+    }
+
+    sectioned_file_writer writer(new_filename, {sets.size() * sizeof(request_set)});
+    writer.write(0, sets.data(), sets.size() * sizeof(request_set));
+    writer.close();
+    fprintf(stderr, "Converted %zu last three maximizers into %s.\n", sets.size(), new_filename.c_str());
+}
+
+void convert_decisions(const std::string& old_filename, const std::string& new_filename) {
+    FILE* binary_file = fopen(old_filename.c_str(), "rb");
+    uint64_t reachable_advsize = 0;
+    if (fread(&reachable_advsize, sizeof(uint64_t), 1, binary_file) != 1) {
+        PRINT_AND_ABORT("ADVSIZE was not read correctly.");
+    }
+    std::vector<std::array<int8_t, 3>> triples(reachable_advsize);
+    if (fread(triples.data(), sizeof(std::array<int8_t, 3>), reachable_advsize, binary_file) != reachable_advsize) {
+        PRINT_AND_ABORT("The decision array was not read correctly.");
+    }
+    fclose(binary_file);
+    std::vector<request_set> sets = to_sets(triples.data(), reachable_advsize);
+
+    binary_file = fopen(new_filename.c_str(), "wb");
+    if (fwrite(&reachable_advsize, sizeof(uint64_t), 1, binary_file) != 1 ||
+        fwrite(sets.data(), sizeof(request_set), reachable_advsize, binary_file) != reachable_advsize) {
+        PRINT_AND_ABORT("The decision array was not written correctly.");
+    }
+    fclose(binary_file);
+    fprintf(stderr, "Converted %" PRIu64 " decisions into %s.\n", reachable_advsize, new_filename.c_str());
+}
+
+int main(void)
+{
+    convert_last_three(last_three_filename + ".int8t", last_three_filename);
+    if (std::filesystem::exists(last_three_after_decisions_filename + ".int8t")) {
+        convert_decisions(last_three_after_decisions_filename + ".int8t", last_three_after_decisions_filename);
+    }
+    return 0;
+}
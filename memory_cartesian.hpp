@@ -37,12 +37,12 @@ public:
     uint64_t data = 0;
 
     uint64_t access(int pos) const {
-        return permutation<PERMSIZE>::perm_from_index_quadratic(data).data[pos];
+        return permutation<PERMSIZE>::perm_from_index(data).data[pos];
     }
 
     // Sends the requested element to the front.
     void mtf(int request) {
-        auto perm = permutation<PERMSIZE>::perm_from_index_quadratic(data);
+        auto perm = permutation<PERMSIZE>::perm_from_index(data);
         perm.mtf_inplace(request);
 
         if (ALG_DEBUG) {
@@ -61,7 +61,7 @@ public:
     }
 
     memory_perm recompute(array_as_permutation *alg_relabeling) {
-        auto perm = permutation<PERMSIZE>::perm_from_index_quadratic(data);
+        auto perm = permutation<PERMSIZE>::perm_from_index(data);
         if(ALG_DEBUG) {
             fprintf(stderr, "Memory before relabeling: ");
             perm.print();
@@ -84,7 +84,7 @@ public:
     }
 
     void full_print() {
-        auto perm = permutation<PERMSIZE>::perm_from_index_quadratic(data);
+        auto perm = permutation<PERMSIZE>::perm_from_index(data);
         perm.print();
     }
 };
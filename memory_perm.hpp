@@ -19,12 +19,12 @@ public:
     uint64_t data = 0;
 
     uint64_t access(int pos) const {
-        return permutation<LISTSIZE>::perm_from_index_quadratic(data).data[pos];
+        return permutation<LISTSIZE>::perm_from_index(data).data[pos];
     }
 
     // Sends the requested element to the front.
     void mtf(int request) {
-        auto perm = permutation<LISTSIZE>::perm_from_index_quadratic(data);
+        auto perm = permutation<LISTSIZE>::perm_from_index(data);
         perm.mtf_inplace(request);
 
         if (ALG_DEBUG) {
@@ -43,7 +43,7 @@ public:
     }
 
     memory_perm recompute(array_as_permutation *alg_relabeling) {
-        auto perm = permutation<LISTSIZE>::perm_from_index_quadratic(data);
+        auto perm = permutation<LISTSIZE>::perm_from_index(data);
         if(ALG_DEBUG) {
             fprintf(stderr, "Memory before relabeling: ");
             perm.print();
@@ -66,7 +66,7 @@ public:
     }
 
     void full_print(FILE *f = stderr, bool newline = true) const {
-        auto perm = permutation<LISTSIZE>::perm_from_index_quadratic(data);
+        auto perm = permutation<LISTSIZE>::perm_from_index(data);
         perm.print(f, newline);
     }
 };
@@ -2,6 +2,7 @@
 
 #include <array>
 #include "common.hpp"
+#include "permutation.hpp"
 
 void recompute_alg_perm(array_as_permutation *alg_p, array_as_permutation *opt_single_swap) {
     for (int i = 0; i <LISTSIZE; i++) {
@@ -91,6 +92,14 @@ void print_permutation(array_as_permutation *perm, FILE *f = stderr, bool newlin
     }
 }
 
+uint64_t lexindex(const array_as_permutation *perm) {
+    return lehmer_rank<LISTSIZE>(*perm);
+}
+
+array_as_permutation perm_from_index(uint64_t index) {
+    return lehmer_unrank<LISTSIZE>(index);
+}
+
 // Quadratic lexicographic order, should be good enough for short arrays.
 uint64_t lexindex_quadratic(array_as_permutation *perm) {
     uint64_t ret = 0;
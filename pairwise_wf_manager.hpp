@@ -1,9 +1,11 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <cinttypes>
 #include <cstdint>
 #include <vector>
-#include <unordered_map>
+#include <unordered_set>
 #include <queue>
 #include <filesystem>
 #include <iostream>
@@ -16,11 +18,19 @@ using boost::serialization::make_binary_object;
 
 
 #include "common.hpp"
-#include "wf/double_zobrist.hpp"
+#include "workfunction.hpp"
 
 
 constexpr uint64_t UNSORTED_PAIRS = (TSIZE * (TSIZE-1))/2;
 
+constexpr uint64_t power_of_three(uint64_t exponent) {
+    return exponent == 0 ? 1 : 3 * power_of_three(exponent - 1);
+}
+
+// The number of states of algorithm_against_pairwise_opt, reachable or not: one of three values per pair.
+constexpr uint64_t PAIRWISE_STATES = power_of_three(UNSORTED_PAIRS);
+static_assert(PAIRWISE_STATES <= UINT32_MAX, "The pairwise states must be indexable by a dense table.");
+
 // Nomenclature:
 // value 0: A < B
 // value 1: A ?= B
@@ -42,6 +52,16 @@ public:
         return sorted_pair_index(std::min(i,j), std::max(i,j));
     }
 
+    // The state as a base-3 number with one digit per pair, the first pair being the lowest digit.
+    // Distinct states have distinct codes, all of them below PAIRWISE_STATES.
+    uint64_t code() const {
+        uint64_t ret = 0;
+        for (int i = UNSORTED_PAIRS - 1; i >= 0; i--) {
+            ret = 3 * ret + vals[i];
+        }
+        return ret;
+    }
+
     void print(FILE *outf = stderr) const {
         for (int i = 0; i < SIZE; i++) {
             for (int j = (i+1); j < SIZE; j++) {
@@ -93,7 +113,6 @@ public:
     }
     static constexpr algorithm_against_pairwise_opt<SIZE> initial_pwf = initial_partial_workfunction();
 
-    std::array<std::array<uint64_t, 3>, UNSORTED_PAIRS> *zobrist;
     // std::vector<pairwise_workfunction<SIZE>> reachable_wfs;
     // std::vector<std::array<unsigned int, SIZE>> adjacent_functions;
     // std::vector<std::array<short, SIZE>> update_costs;
@@ -103,29 +122,15 @@ public:
     std::array<unsigned int, SIZE>* adjacent_functions_arr = nullptr;
     std::array<short, SIZE>* update_costs_arr = nullptr;
 
-    std::unordered_map<uint64_t, unsigned int> hash_to_index;
+    // The index of each state by its code(), NO_STATE if it is not reachable. A dense table over all
+    // PAIRWISE_STATES, which is 57 MB for SIZE=6, and exact, unlike a hash of the state.
+    static constexpr unsigned int NO_STATE = UINT32_MAX;
+    std::vector<unsigned int> index_of_code;
     // std::vector<std::array<unsigned int, SIZE>> adjacent_functions;
     // std::vector<std::array<short, SIZE>> update_costs;
-    pairwise_wf_manager() {
 
-            zobrist = new std::array<std::array<uint64_t, 3>, UNSORTED_PAIRS>();
-            for (int i = 0; i < UNSORTED_PAIRS; i++) {
-                for (int v = 0; v < 2; v++) {
-                    (*zobrist)[i][v] = rand_64bit();
-                }
-            }
-    }
-
-    ~pairwise_wf_manager() {
-        delete zobrist;
-    }
-
-    uint64_t hash(algorithm_against_pairwise_opt<SIZE> *pwf) {
-        uint64_t ret = 0;
-        for (int i = 0; i < UNSORTED_PAIRS; i++) {
-            ret ^= (*zobrist)[i][pwf->vals[i]];
-        }
-        return ret;
+    unsigned int index_of(const algorithm_against_pairwise_opt<SIZE>& pwf) const {
+        return index_of_code[pwf.code()];
     }
 
 
@@ -146,7 +151,7 @@ public:
             PRINT_AND_ABORT("The number of reachable workfunctions was not written correctly.");
         }
 
-        written = fwrite(reachable_wfs_arr, sizeof(workfunction<SIZE>), reachable_workfunctions,
+        written = fwrite(reachable_wfs_arr, sizeof(algorithm_against_pairwise_opt<SIZE>), reachable_workfunctions,
                          binary_file);
         if (written != reachable_workfunctions) {
             PRINT_AND_ABORT("The array of reachable work functions was not written correctly.");
@@ -175,11 +180,11 @@ public:
             PRINT_AND_ABORT("The number of reachable workfunctions was not read correctly.");
         }
 
-        reachable_wfs_arr = new workfunction<SIZE>[reachable_workfunctions];
+        reachable_wfs_arr = new algorithm_against_pairwise_opt<SIZE>[reachable_workfunctions];
         update_costs_arr = new std::array<short, SIZE>[reachable_workfunctions];
         adjacent_functions_arr = new std::array<unsigned int, SIZE>[reachable_workfunctions];
 
-        read = fread(reachable_wfs_arr, sizeof(workfunction<SIZE>), reachable_workfunctions,
+        read = fread(reachable_wfs_arr, sizeof(algorithm_against_pairwise_opt<SIZE>), reachable_workfunctions,
                          binary_file);
         if (read != reachable_workfunctions) {
             PRINT_AND_ABORT("The array of reachable work functions was not read correctly.");
@@ -201,17 +206,17 @@ public:
     }
 
 
-    void fill_hash_to_index() {
-        hash_to_index.clear();
-        for (int i = 0; i < reachable_workfunctions; i++) {
-            hash_to_index[hash(&(reachable_wfs_arr[i]))] = i;
+    void fill_index_of_code() {
+        index_of_code.assign(PAIRWISE_STATES, NO_STATE);
+        for (uint64_t i = 0; i < reachable_workfunctions; i++) {
+            index_of_code[reachable_wfs_arr[i].code()] = i;
         }
     }
 
     void initialize_reachable(std::string reachable_filename) {
         if (std::filesystem::exists(reachable_filename)) {
             deserialize_reachable(reachable_filename);
-            fill_hash_to_index();
+            fill_index_of_code();
         } else {
             initialize_reachable_from_scratch();
             serialize_reachable(reachable_filename);
@@ -219,22 +224,121 @@ public:
     }
 
 
+    // Parents expanded at once by initialize_reachable_from_scratch(), as in wf_manager.
+    static constexpr uint64_t REACHABLE_BFS_CHUNK = 1LLU << 14;
+
+    // A level-synchronous parallel version of the BFS below, the same as the one of wf_manager.
+    // The parents of a level are expanded in chunks; the children of a chunk are computed in parallel.
+    // A new state is assigned to its first occurrence in the order (parent index, request), which is
+    // the order of the sequential BFS queue, so the indices and the serialized file are identical.
+    //
+    // The states are deduplicated by their codes through index_of_code, and the first occurrence
+    // of a new state in a chunk is found by an atomic min over a dense table of slots, so no locks are needed.
     void initialize_reachable_from_scratch() {
-        std::unordered_set<uint64_t> reachable_hashes;
+        std::vector<algorithm_against_pairwise_opt<SIZE>> reachable_wfs_vec;
+        std::vector<std::array<uint64_t, SIZE>> adjacencies_by_code;
+        std::vector<std::array<short, SIZE>> update_costs_vec;
+
+        index_of_code.assign(PAIRWISE_STATES, NO_STATE);
+        // The first slot of the current chunk in which the code was found, if it is new.
+        constexpr uint32_t NO_SLOT = UINT32_MAX;
+        std::vector<uint32_t> claims(PAIRWISE_STATES, NO_SLOT);
+
+        algorithm_against_pairwise_opt<SIZE> initial = initial_pwf;
+        index_of_code[initial.code()] = 0;
+        reachable_wfs_vec.push_back(initial);
+
+        uint64_t level_start = 0;
+        uint64_t level = 0;
+        while (level_start < reachable_wfs_vec.size()) {
+            const uint64_t level_end = reachable_wfs_vec.size();
+            for (uint64_t chunk_start = level_start; chunk_start < level_end; chunk_start += REACHABLE_BFS_CHUNK) {
+                const uint64_t chunk_end = std::min(chunk_start + REACHABLE_BFS_CHUNK, level_end);
+                const uint64_t slots = (chunk_end - chunk_start) * SIZE;
+                std::vector<algorithm_against_pairwise_opt<SIZE>> children(slots);
+                adjacencies_by_code.resize(chunk_end);
+                update_costs_vec.resize(chunk_end);
+
+#pragma omp parallel for schedule(dynamic, 64)
+                for (uint64_t i = chunk_start; i < chunk_end; i++) {
+                    for (short req = 0; req < SIZE; req++) {
+                        const uint32_t slot = (i - chunk_start) * SIZE + req;
+                        algorithm_against_pairwise_opt<SIZE>& new_wf = children[slot];
+                        new_wf = reachable_wfs_vec[i];
+                        update_costs_vec[i][req] = new_wf.update(req);
+
+                        const uint64_t c = new_wf.code();
+                        adjacencies_by_code[i][req] = c;
+                        if (index_of_code[c] == NO_STATE) {
+                            std::atomic_ref<uint32_t> claim(claims[c]);
+                            uint32_t current = claim.load(std::memory_order_relaxed);
+                            while (slot < current && !claim.compare_exchange_weak(current, slot)) {}
+                        }
+                    }
+                }
+
+                // Exactly the first occurrence of each new code gets a new index.
+                std::vector<uint64_t> new_offsets(slots + 1, 0);
+#pragma omp parallel for
+                for (uint64_t slot = 0; slot < slots; slot++) {
+                    new_offsets[slot + 1] = claims[children[slot].code()] == slot;
+                }
+                for (uint64_t slot = 0; slot < slots; slot++) {
+                    new_offsets[slot + 1] += new_offsets[slot];
+                }
+
+                const uint64_t first_new_index = reachable_wfs_vec.size();
+                reachable_wfs_vec.resize(first_new_index + new_offsets[slots]);
+#pragma omp parallel for
+                for (uint64_t slot = 0; slot < slots; slot++) {
+                    if (new_offsets[slot + 1] != new_offsets[slot]) {
+                        const uint64_t c = children[slot].code();
+                        reachable_wfs_vec[first_new_index + new_offsets[slot]] = children[slot];
+                        index_of_code[c] = first_new_index + new_offsets[slot];
+                        claims[c] = NO_SLOT;
+                    }
+                }
+            }
+
+            fprintf(stderr, "Level %" PRIu64 ": %" PRIu64 " pairwise states, %zu reachable in total.\n",
+                    level, level_end - level_start, reachable_wfs_vec.size());
+            level_start = level_end;
+            level++;
+        }
+
+        reachable_workfunctions = reachable_wfs_vec.size();
+        reachable_wfs_arr = new algorithm_against_pairwise_opt<SIZE>[reachable_workfunctions];
+        update_costs_arr = new std::array<short, SIZE>[reachable_workfunctions];
+        adjacent_functions_arr = new std::array<unsigned int, SIZE>[reachable_workfunctions];
+
+#pragma omp parallel for
+        for (uint64_t i = 0; i < reachable_workfunctions; i++) {
+            reachable_wfs_arr[i] = reachable_wfs_vec[i];
+            update_costs_arr[i] = update_costs_vec[i];
+            for (int j = 0; j < SIZE; j++) {
+                adjacent_functions_arr[i][j] = index_of_code[adjacencies_by_code[i][j]];
+            }
+        }
+    }
+
+    // The original single-threaded BFS. Kept as a reference for initialize_reachable_from_scratch().
+    void initialize_reachable_from_scratch_sequential() {
+        std::unordered_set<uint64_t> reachable_codes;
         std::vector<algorithm_against_pairwise_opt<SIZE>> reachable_wfs_vec;
         std::vector<std::array<unsigned int, SIZE>> adjacent_functions_vec;
         std::vector<std::array<short, SIZE>> update_costs_vec;
 
-        std::vector<std::array<uint64_t, SIZE>> adjacencies_by_hash;
+        std::vector<std::array<uint64_t, SIZE>> adjacencies_by_code;
 
+        index_of_code.assign(PAIRWISE_STATES, NO_STATE);
         algorithm_against_pairwise_opt<SIZE> initial = initial_pwf;
         std::queue<algorithm_against_pairwise_opt<SIZE>> q;
-        reachable_hashes.insert(hash(&initial));
+        reachable_codes.insert(initial.code());
         q.push(initial);
         while (!q.empty()) {
             algorithm_against_pairwise_opt<SIZE> front = q.front();
             q.pop();
-            hash_to_index[hash(&front)] = reachable_wfs_vec.size();
+            index_of_code[front.code()] = reachable_wfs_vec.size();
             reachable_wfs_vec.push_back(front);
             std::array<uint64_t, SIZE> adj;
             std::array<short, SIZE> upd_cost;
@@ -245,14 +349,14 @@ public:
                 upd_cost[req] = cost;
                 // new_wf.validate();
 
-                uint64_t h = hash(&new_wf);
-                adj[req] = h;
-                if (!reachable_hashes.contains(h)) {
-                    reachable_hashes.insert(h);
+                uint64_t c = new_wf.code();
+                adj[req] = c;
+                if (!reachable_codes.contains(c)) {
+                    reachable_codes.insert(c);
                     q.push(new_wf);
                 }
             }
-            adjacencies_by_hash.push_back(adj);
+            adjacencies_by_code.push_back(adj);
             update_costs_vec.push_back(upd_cost);
         }
 
@@ -260,7 +364,7 @@ public:
         // serialize to a file.
 
         reachable_workfunctions = reachable_wfs_vec.size();
-        reachable_wfs_arr = new workfunction<SIZE>[reachable_workfunctions];
+        reachable_wfs_arr = new algorithm_against_pairwise_opt<SIZE>[reachable_workfunctions];
         update_costs_arr = new std::array<short, SIZE>[reachable_workfunctions];
         adjacent_functions_arr = new std::array<unsigned int, SIZE>[reachable_workfunctions];
 
@@ -268,10 +372,10 @@ public:
             reachable_wfs_arr[i] = reachable_wfs_vec[i];
             update_costs_arr[i] = update_costs_vec[i];
 
-            const auto& adj_by_hash = adjacencies_by_hash[i];
+            const auto& adj_by_code = adjacencies_by_code[i];
             std::array<unsigned int, SIZE> adj_by_index;
             for (int j = 0; j < SIZE; j++) {
-                adj_by_index[j] = hash_to_index[adj_by_hash[j]];
+                adj_by_index[j] = index_of_code[adj_by_code[j]];
             }
 
             adjacent_functions_arr[i] = adj_by_index;
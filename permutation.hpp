@@ -5,15 +5,100 @@
 #include <array>
 #include <cinttypes>
 #include <cstdint>
+#include <bit>
 
 #include "common.hpp"
 #include "workfunction.hpp"
 
+// Ranking and unranking of permutations in the lexicographic order via the Lehmer code.
+// The elements placed so far are kept in a bitmask, so the relative position of an element
+// among the unplaced ones is a single popcount, and the unranking needs to select the k-th unset bit.
+
+// For occupancy masks of up to 8 elements, the number of set bits and the position of the k-th unset bit,
+// both precomputed. The table lookup beats std::popcount unless the build targets a CPU with POPCNT.
+constexpr std::array<int8_t, 256> popcount_table() {
+    std::array<int8_t, 256> table{};
+    for (int mask = 0; mask < 256; mask++) {
+        table[mask] = (int8_t) std::popcount((unsigned int) mask);
+    }
+    return table;
+}
+
+constexpr std::array<int8_t, 256> POPCOUNT = popcount_table();
+
+constexpr std::array<std::array<int8_t, 8>, 256> nth_unset_bit_table() {
+    std::array<std::array<int8_t, 8>, 256> table{};
+    for (int mask = 0; mask < 256; mask++) {
+        int k = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            table[mask][bit] = -1;
+        }
+        for (int bit = 0; bit < 8; bit++) {
+            if ((mask & (1 << bit)) == 0) {
+                table[mask][k++] = (int8_t) bit;
+            }
+        }
+    }
+    return table;
+}
+
+constexpr std::array<std::array<int8_t, 8>, 256> NTH_UNSET_BIT = nth_unset_bit_table();
+
+template <short SIZE> inline short occupancy_popcount(uint32_t mask) {
+    if constexpr (SIZE <= 8) {
+        return POPCOUNT[mask];
+    } else {
+        return (short) std::popcount(mask);
+    }
+}
+
+template <short SIZE> inline short nth_unset_bit(uint32_t mask, short k) {
+    if constexpr (SIZE <= 8) {
+        return NTH_UNSET_BIT[mask][k];
+    } else {
+        uint32_t unset = ~mask;
+        for (short i = 0; i < k; i++) {
+            unset &= unset - 1;
+        }
+        return (short) std::countr_zero(unset);
+    }
+}
+
+template <short SIZE> inline uint64_t lehmer_rank(const std::array<short, SIZE>& data) {
+    static_assert(SIZE <= 16);
+    uint32_t placed = 0;
+    uint64_t ret = 0;
+    for (int i = 0; i < SIZE; i++) {
+        uint32_t smaller = (1u << data[i]) - 1;
+        ret += (data[i] - occupancy_popcount<SIZE>(placed & smaller)) * factorial[SIZE - 1 - i];
+        placed |= 1u << data[i];
+    }
+    return ret;
+}
+
+template <short SIZE> inline std::array<short, SIZE> lehmer_unrank(uint64_t index) {
+    static_assert(SIZE <= 16);
+    std::array<short, SIZE> ret;
+    uint32_t placed = 0;
+    for (int i = 0; i < SIZE; i++) {
+        short relpos = (short) (index / factorial[SIZE - 1 - i]);
+        index %= factorial[SIZE - 1 - i];
+        ret[i] = nth_unset_bit<SIZE>(placed, relpos);
+        placed |= 1u << ret[i];
+    }
+    return ret;
+}
+
 template <short SIZE> class permutation {
 public:
     std::array<short, SIZE> data;
 
     uint64_t id() const {
+        return lehmer_rank<SIZE>(data);
+    }
+
+    // The original quadratic ranking, kept as a reference for lehmer_rank().
+    uint64_t id_quadratic() const {
         // Quadratic lexicographic order, should be good enough for short arrays.
         uint64_t ret = 0;
         for ( int i = 0; i < SIZE; i ++) {
@@ -116,7 +201,7 @@ public:
     }
 
     short inversions() const {
-        return invs->vals[id()];
+        return inversion_wf<SIZE>->vals[id()];
     }
 
     short inversions_wrt(const permutation<SIZE> *other) const {
@@ -133,6 +218,13 @@ public:
         return copy.inversions();
     }
 
+    static permutation<SIZE> perm_from_index(uint64_t index) {
+        permutation<SIZE> ret;
+        ret.data = lehmer_unrank<SIZE>(index);
+        return ret;
+    }
+
+    // The original quadratic unranking, kept as a reference for perm_from_index().
     static permutation<SIZE> perm_from_index_quadratic(uint64_t index) {
         permutation<SIZE> ret;
 
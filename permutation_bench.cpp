@@ -0,0 +1,75 @@
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#include "permutation_graph.hpp"
+#include "old_perm_functions.hpp"
+
+// Compares the Lehmer code ranking and unranking against the quadratic versions,
+// first for equality on all permutations, then in running time.
+
+constexpr int BENCH_ROUNDS = 200;
+
+template <typename F> double time_ms(F f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(void) {
+    pg = new permutation_graph<LISTSIZE>();
+    pg->init();
+
+    uint64_t mismatches = 0;
+    for (uint64_t i = 0; i < factorial[LISTSIZE]; i++) {
+        const permutation<LISTSIZE>& perm = pg->all_perms[i];
+        if (perm.id() != i || perm.id_quadratic() != i) {
+            mismatches++;
+        }
+        if (permutation<LISTSIZE>::perm_from_index(i).data != perm.data ||
+            permutation<LISTSIZE>::perm_from_index_quadratic(i).data != perm.data) {
+            mismatches++;
+        }
+        if (lexindex(&perm.data) != i || perm_from_index(i) != perm.data) {
+            mismatches++;
+        }
+    }
+    fprintf(stderr, "Ranking and unranking: %" PRIu64 " mismatches.\n", mismatches);
+
+    uint64_t checksum = 0;
+    double rank_quadratic = time_ms([&] {
+        for (int round = 0; round < BENCH_ROUNDS; round++) {
+            for (const auto& perm : pg->all_perms) {
+                checksum += perm.id_quadratic();
+            }
+        }
+    });
+    double rank_linear = time_ms([&] {
+        for (int round = 0; round < BENCH_ROUNDS; round++) {
+            for (const auto& perm : pg->all_perms) {
+                checksum += perm.id();
+            }
+        }
+    });
+    double unrank_quadratic = time_ms([&] {
+        for (int round = 0; round < BENCH_ROUNDS; round++) {
+            for (uint64_t i = 0; i < factorial[LISTSIZE]; i++) {
+                checksum += permutation<LISTSIZE>::perm_from_index_quadratic(i).data[LISTSIZE - 1];
+            }
+        }
+    });
+    double unrank_linear = time_ms([&] {
+        for (int round = 0; round < BENCH_ROUNDS; round++) {
+            for (uint64_t i = 0; i < factorial[LISTSIZE]; i++) {
+                checksum += permutation<LISTSIZE>::perm_from_index(i).data[LISTSIZE - 1];
+            }
+        }
+    });
+
+    fprintf(stderr, "Ranking %d x %" PRIu64 " permutations: quadratic %.2f ms, Lehmer %.2f ms.\n",
+            BENCH_ROUNDS, factorial[LISTSIZE], rank_quadratic, rank_linear);
+    fprintf(stderr, "Unranking %d x %" PRIu64 " permutations: quadratic %.2f ms, Lehmer %.2f ms.\n",
+            BENCH_ROUNDS, factorial[LISTSIZE], unrank_quadratic, unrank_linear);
+    fprintf(stderr, "Checksum %" PRIu64 ".\n", checksum);
+    return mismatches == 0 ? 0 : 1;
+}
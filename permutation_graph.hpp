@@ -147,4 +147,6 @@ public:
 };
 
 // A global variable to use the current permutation graph elsewhere. Slightly ugly, but fast.
-permutation_graph<LISTSIZE> *pg = nullptr;
\ No newline at end of file
+// One per list size, so that a program may work with several list sizes; pg is the one for LISTSIZE.
+template <short SIZE> permutation_graph<SIZE> *perm_graph = nullptr;
+permutation_graph<LISTSIZE> *&pg = perm_graph<LISTSIZE>;
\ No newline at end of file
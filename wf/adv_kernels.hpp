@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "../common.hpp"
+
+// Kernels computing the new potentials of all ADV vertices of one work function at once.
+// For request r, sources[r] points to the ALG vertex (adjacent work function, permutation 0, r);
+// the ALG vertex for permutation p is then sources[r][p * SIZE]. The kernel writes
+// max_r (sources[r][p * SIZE] - costs[r]) into new_pots[p] for every permutation p.
+//
+// The vectorized kernels gather 32 bits per element, so they may read one short past the last
+// ALG vertex; the ALG array needs to be padded by one element. They process 16 permutations at a time
+// and leave the tail to adv_block_scalar_range(), behind if constexpr: 6! and 7! are multiples of 16
+// and leave no tail, and GCC would warn about the dead loop otherwise.
+
+template <short SIZE> using adv_block_kernel = void (*)(const std::array<const short*, SIZE>& sources,
+                                                        const std::array<short, SIZE>& costs, short* new_pots);
+
+template <short SIZE> void adv_block_scalar_range(const std::array<const short*, SIZE>& sources,
+                                                  const std::array<short, SIZE>& costs, short* new_pots,
+                                                  uint64_t from) {
+    for (uint64_t p = from; p < factorial[SIZE]; p++) {
+        short new_pot = std::numeric_limits<short>::min();
+        for (int r = 0; r < SIZE; r++) {
+            if (sources[r][p * SIZE] - costs[r] > new_pot) {
+                new_pot = sources[r][p * SIZE] - costs[r];
+            }
+        }
+        new_pots[p] = new_pot;
+    }
+}
+
+template <short SIZE> void adv_block_scalar(const std::array<const short*, SIZE>& sources,
+                                            const std::array<short, SIZE>& costs, short* new_pots) {
+    adv_block_scalar_range<SIZE>(sources, costs, new_pots, 0);
+}
+
+#if defined(__x86_64__)
+
+template <short SIZE> __attribute__((target("avx2")))
+void adv_block_avx2(const std::array<const short*, SIZE>& sources,
+                    const std::array<short, SIZE>& costs, short* new_pots) {
+    const __m256i stride = _mm256_setr_epi32(0, SIZE, 2 * SIZE, 3 * SIZE, 4 * SIZE, 5 * SIZE, 6 * SIZE, 7 * SIZE);
+    uint64_t p = 0;
+    for (; p + 16 <= factorial[SIZE]; p += 16) {
+        __m256i best = _mm256_set1_epi16(std::numeric_limits<short>::min());
+        for (int r = 0; r < SIZE; r++) {
+            __m256i lo = _mm256_i32gather_epi32(reinterpret_cast<const int*>(sources[r] + p * SIZE), stride, 2);
+            __m256i hi = _mm256_i32gather_epi32(reinterpret_cast<const int*>(sources[r] + (p + 8) * SIZE), stride, 2);
+            // Keep only the low (requested) short of every gathered int, sign-extended.
+            lo = _mm256_srai_epi32(_mm256_slli_epi32(lo, 16), 16);
+            hi = _mm256_srai_epi32(_mm256_slli_epi32(hi, 16), 16);
+            // packs works within 128-bit lanes, the permutation restores the order of permutations.
+            __m256i pots = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+            pots = _mm256_sub_epi16(pots, _mm256_set1_epi16(costs[r]));
+            best = _mm256_max_epi16(best, pots);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(new_pots + p), best);
+    }
+    if constexpr (factorial[SIZE] % 16 != 0) {
+        adv_block_scalar_range<SIZE>(sources, costs, new_pots, p);
+    }
+}
+
+template <short SIZE> __attribute__((target("avx512f,avx2")))
+void adv_block_avx512(const std::array<const short*, SIZE>& sources,
+                      const std::array<short, SIZE>& costs, short* new_pots) {
+    const __m512i stride = _mm512_setr_epi32(0, SIZE, 2 * SIZE, 3 * SIZE, 4 * SIZE, 5 * SIZE, 6 * SIZE, 7 * SIZE,
+                                             8 * SIZE, 9 * SIZE, 10 * SIZE, 11 * SIZE, 12 * SIZE, 13 * SIZE,
+                                             14 * SIZE, 15 * SIZE);
+    uint64_t p = 0;
+    for (; p + 16 <= factorial[SIZE]; p += 16) {
+        __m256i best = _mm256_set1_epi16(std::numeric_limits<short>::min());
+        for (int r = 0; r < SIZE; r++) {
+            __m512i gathered = _mm512_i32gather_epi32(stride, sources[r] + p * SIZE, 2);
+            // Truncation keeps exactly the requested short of every gathered int.
+            __m256i pots = _mm512_cvtepi32_epi16(gathered);
+            pots = _mm256_sub_epi16(pots, _mm256_set1_epi16(costs[r]));
+            best = _mm256_max_epi16(best, pots);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(new_pots + p), best);
+    }
+    if constexpr (factorial[SIZE] % 16 != 0) {
+        adv_block_scalar_range<SIZE>(sources, costs, new_pots, p);
+    }
+}
+
+#endif
+
+template <short SIZE> adv_block_kernel<SIZE> select_adv_block_kernel(const char** name = nullptr) {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        if (name != nullptr) {
+            *name = "avx512";
+        }
+        return adv_block_avx512<SIZE>;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        if (name != nullptr) {
+            *name = "avx2";
+        }
+        return adv_block_avx2<SIZE>;
+    }
+#endif
+    if (name != nullptr) {
+        *name = "scalar";
+    }
+    return adv_block_scalar<SIZE>;
+}
@@ -1,54 +1,79 @@
+#define RUNTIME_SIZE_AND_RATIO
+
 #include <cstdlib>
 #include <cstdio>
+#include <cmath>
+#include <cstring>
 #include <unordered_set>
 #include <queue>
 #include "../permutation_graph.hpp"
 #include "../wf_manager.hpp"
 #include "../workfunction.hpp"
 #include "game_graph.hpp"
+#include "checkpoint.hpp"
+#include "telemetry.hpp"
 
+// The list size and the competitive ratio are chosen on the command line. Each supported list size
+// has its own instantiation of the game graph, so the hot loops are compiled for it.
+constexpr short MIN_RUNTIME_SIZE = 3;
+constexpr short MAX_RUNTIME_SIZE = TSIZE;
 
-int main() {
-    std::string workfunctions_filename = std::string("wfs-") + std::to_string(LISTSIZE) + std::string(".log");
-    std::string workfunctions_binary_filename = std::string("wfs-reachable-") + std::to_string(LISTSIZE) +
-        std::string(".bin");
-
-
-    pg = new permutation_graph<LISTSIZE>();
-    pg->init();
-
-    invs = new workfunction<LISTSIZE>{};
-    wf_manager<LISTSIZE>::initialize_inversions();
-    pg->populate_quick_inversions();
-    fprintf(stderr, "Total permutations %zu.\n", pg->all_perms.size());
-
-    wf_manager<TESTSIZE> wm(*pg);
-
-    // invs->print();
-    wm.initialize_reachable(workfunctions_binary_filename);
-    uint64_t rchbl = wm.reachable_workfunctions;
-    fprintf(stderr, "Reachable: %" PRIu64 ".\n", rchbl);
-
-    // The actual deal.
+// The ALG moves of the class of algorithms being tested.
+constexpr alg_moves TESTED_ALG_MOVES = alg_moves::request_moves_forward;
 
-    std::string bin_name{};
-    if (std::filesystem::exists(graph_binary_filename)) {
-        bin_name = graph_binary_filename;
-    }
-    game_graph<TESTSIZE> g(wm, true, bin_name);
-    if (std::filesystem::exists(last_three_filename)) {
-        fprintf(stderr, "Loading last three ADV choices from the binary file.\n");
-        g.deserialize_last_three(last_three_filename);
-    }
+struct driver_options {
+    short size = 0;
+    // Equal unless searching for the ratio.
+    long double low_ratio = 0;
+    long double high_ratio = 0;
+    // A graph file whose potentials seed the computation, see game_graph::valid_warm_start().
+    std::string seed_filename{};
+    // Checkpoints of a single ratio run, see potential_checkpoint.
+    std::chrono::seconds checkpoint_interval{CHECKPOINT_INTERVAL_SECONDS};
+    bool resume = false;
+    // If set, a JSON line per round is written there, see iteration_telemetry.
+    std::string telemetry_filename{};
+};
 
+// Iterates the potentials of the game graph until they stabilize, or until the min ADV potential
+// reaches one, in which case an algorithm of this class may not exist for the ratio of the graph.
+// Starts with the given round, which is nonzero when resuming, and saves checkpoints between rounds.
+template <short SIZE> bool potentials_stabilize(game_graph<SIZE>& g, iteration_telemetry<SIZE>* telemetry,
+                                                potential_checkpoint<SIZE>* checkpoint = nullptr,
+                                                uint64_t first_round = 0) {
     bool anything_updated = true;
-    uint64_t iter_count = 0;
+    uint64_t iter_count = first_round;
     while(anything_updated) {
         //if (iter_count % 10 == 0) {
         fprintf(stderr, "Iteration %" PRIu64 ".\n", iter_count);
         //}
-        if (g.min_adv_potential() <= 0) {
-            bool adv_updated = g.update_adv();
+        const bool running = g.min_adv_potential() <= 0;
+        if (telemetry != nullptr) {
+            telemetry->start_phase();
+        }
+        if (running && GRAPH_SCHEDULE == update_schedule::worklist) {
+            bool adv_updated = g.worklist_update_adv();
+            if (telemetry != nullptr) {
+                telemetry->end_adv_phase();
+                telemetry->start_phase();
+            }
+            bool alg_updated = g.worklist_update_alg();
+            if (telemetry != nullptr) {
+                telemetry->end_alg_phase();
+            }
+            anything_updated = adv_updated || alg_updated;
+        } else if (running && GRAPH_SCHEDULE == update_schedule::gauss_seidel) {
+            anything_updated = g.gauss_seidel_update();
+            if (telemetry != nullptr) {
+                telemetry->end_adv_phase();
+            }
+        } else if (running) {
+            bool adv_updated = g.update_adv_vectorized();
+            if (telemetry != nullptr) {
+                telemetry->end_adv_phase();
+                telemetry->start_phase();
+            }
+            // bool adv_updated = g.update_adv();
             // bool adv_updated = g.update_adv_save_last_three(iter_count);
             // bool adv_updated = g.update_adv_only_use_last_three(iter_count);
             // bool alg_updated = g.update_alg();
@@ -58,22 +83,258 @@ int main() {
             // bool alg_updated = g.update_alg_wfa();
             // bool alg_updated = g.update_alg_wfa_faster();
             // bool alg_updated = g.update_alg_wfa_unique_only();
+            if (telemetry != nullptr) {
+                telemetry->end_alg_phase();
+            }
             anything_updated = adv_updated || alg_updated;
         }
+        if (running && telemetry != nullptr) {
+            telemetry->record(g, iter_count);
+        }
 
         if (g.min_adv_potential() >= 1) {
-            fprintf(stdout, "The min ADV potential is higher than one. An algorithm of this class may not exist.\n");
-            return 0;
+            fprintf(stderr, "Finished after %" PRIu64 " iterations of the %s schedule.\n",
+                    iter_count + 1, schedule_name(GRAPH_SCHEDULE));
+            return false;
         }
         iter_count++;
+        if (checkpoint != nullptr && anything_updated) {
+            checkpoint->maybe_save(g, iter_count);
+        }
+    }
+
+    fprintf(stderr, "Finished after %" PRIu64 " iterations of the %s schedule.\n",
+            iter_count, schedule_name(GRAPH_SCHEDULE));
+    return true;
+}
+
+template <short SIZE> void prepare_schedule(game_graph<SIZE>& g) {
+    if (GRAPH_SCHEDULE == update_schedule::worklist) {
+        g.init_worklist(TESTED_ALG_MOVES);
+    } else if (GRAPH_SCHEDULE == update_schedule::gauss_seidel) {
+        g.init_alg_moves(TESTED_ALG_MOVES);
+    }
+}
+
+// Keeps the seeded potentials only if they are a valid starting point.
+template <short SIZE> void check_seed(game_graph<SIZE>& g, const std::string& seed_filename) {
+    if (g.valid_warm_start(TESTED_ALG_MOVES)) {
+        fprintf(stderr, "Starting from the potentials in %s.\n", seed_filename.c_str());
+    } else {
+        fprintf(stderr, "The potentials in %s are not a valid starting point, starting from zero.\n",
+                seed_filename.c_str());
+        g.reset_potentials();
+    }
+}
+
+template <short SIZE> void initialize_globals() {
+    perm_graph<SIZE> = new permutation_graph<SIZE>();
+    perm_graph<SIZE>->init();
+    if (CANONICAL_ORBITS) {
+        perm_graph<SIZE>->populate_composition();
+    }
+
+    wf_manager<SIZE>::initialize_inversions();
+    perm_graph<SIZE>->populate_quick_inversions();
+}
+
+std::string reachable_binary_filename(short size) {
+    std::string orbits = CANONICAL_ORBITS ? std::string("canonical-") : std::string("");
+    return std::string("wfs-reachable-") + orbits + std::to_string(size) + std::string(".bin");
+}
+
+template <short SIZE> int algorithm_against_opt(const driver_options& opts) {
+    const long double ratio = opts.low_ratio;
+    const std::string& seed_filename = opts.seed_filename;
+    static_assert(!CANONICAL_ORBITS || GRAPH_SCHEDULE != update_schedule::worklist);
+    std::string orbits = CANONICAL_ORBITS ? std::string("canonical-") : std::string("");
+    std::string graph_filename = std::string("wfs-graph-") + orbits + std::to_string(SIZE)
+        + std::string("-ratio-") + std::to_string(ratio) + std::string(".bin");
+    std::string last_three_filename = std::string("last-three-maximizers-") + std::to_string(SIZE) +
+        std::string(".bin");
+    std::string checkpoint_filename = std::string("checkpoint-") + orbits + std::to_string(SIZE)
+        + std::string("-ratio-") + std::to_string(ratio) + std::string(".bin");
+
+    initialize_globals<SIZE>();
+    fprintf(stderr, "List size %d, ratio %Lf. Total permutations %zu.\n", SIZE, ratio,
+            perm_graph<SIZE>->all_perms.size());
+
+    wf_manager<SIZE> wm(*perm_graph<SIZE>, CANONICAL_ORBITS);
+
+    // invs->print();
+    wm.initialize_reachable(reachable_binary_filename(SIZE));
+    uint64_t rchbl = wm.reachable_workfunctions;
+    fprintf(stderr, "Reachable: %" PRIu64 ".\n", rchbl);
+
+    // The actual deal.
+
+    std::string bin_name{};
+    if (std::filesystem::exists(graph_filename)) {
+        bin_name = graph_filename;
+    } else {
+        bin_name = seed_filename;
+    }
+    game_graph<SIZE> g(wm, true, bin_name, COMPACT_ALG_POTENTIALS, ratio);
+    if (!seed_filename.empty() && bin_name == seed_filename) {
+        check_seed<SIZE>(g, seed_filename);
+    }
+    if (std::filesystem::exists(last_three_filename)) {
+        fprintf(stderr, "Loading last three ADV choices from the binary file.\n");
+        g.deserialize_last_three(last_three_filename);
     }
 
+    prepare_schedule<SIZE>(g);
+    uint64_t first_round = 0;
+    if (opts.resume && std::filesystem::exists(checkpoint_filename)) {
+        first_round = potential_checkpoint<SIZE>::resume(g, checkpoint_filename);
+        if (GRAPH_SCHEDULE == update_schedule::worklist) {
+            g.mark_all_dirty();
+        }
+    }
+
+    potential_checkpoint<SIZE> checkpoint(checkpoint_filename, opts.checkpoint_interval);
+    std::unique_ptr<iteration_telemetry<SIZE>> telemetry;
+    if (!opts.telemetry_filename.empty()) {
+        telemetry = std::make_unique<iteration_telemetry<SIZE>>(opts.telemetry_filename);
+    }
+    bool stabilized = potentials_stabilize<SIZE>(g, telemetry.get(), &checkpoint, first_round);
+    checkpoint.wait();
+    std::filesystem::remove(checkpoint_filename);
+    if (!stabilized) {
+        fprintf(stdout, "The min ADV potential is higher than one. An algorithm of this class may not exist.\n");
+        return 0;
+    }
+
+    if (g.alg_compact != nullptr) {
+        g.alg_compact->report("ALG");
+    }
     fprintf(stdout, "The potentials have stabilized with min potential 0. An algorithm likely exists.\n");
 
-    if (!std::filesystem::exists(graph_binary_filename)) {
-        g.write_graph_binary(graph_binary_filename);
+    if (!std::filesystem::exists(graph_filename)) {
+        g.write_graph_binary(graph_filename);
     }
     // wm.print_reachable(workfunctions_filename);
     // g.print_potential();
     return 0;
 }
+
+// Finds the smallest ratio in [low, high] for which the potentials stabilize, by bisection
+// over the ratios which are multiples of 1 / MULTIPLIER. Feasibility is monotone in the ratio,
+// as the ADV costs only grow with it.
+//
+// The work functions and the game graph are built once. Each probe starts from the potentials
+// of the smallest feasible ratio found so far: the least fixpoint only grows as the ratio decreases,
+// so the iteration from there reaches the same fixpoint (or the same failure) as from zero, only sooner.
+template <short SIZE> int ratio_search(const driver_options& opts) {
+    const long double low = opts.low_ratio;
+    const long double high = opts.high_ratio;
+    const std::string& seed_filename = opts.seed_filename;
+    std::unique_ptr<iteration_telemetry<SIZE>> telemetry;
+    if (!opts.telemetry_filename.empty()) {
+        telemetry = std::make_unique<iteration_telemetry<SIZE>>(opts.telemetry_filename);
+    }
+    static_assert(!CANONICAL_ORBITS || GRAPH_SCHEDULE != update_schedule::worklist);
+    initialize_globals<SIZE>();
+    wf_manager<SIZE> wm(*perm_graph<SIZE>, CANONICAL_ORBITS);
+    wm.initialize_reachable(reachable_binary_filename(SIZE));
+    fprintf(stderr, "List size %d, ratio search in [%Lf, %Lf]. Reachable: %" PRIu64 ".\n",
+            SIZE, low, high, wm.reachable_workfunctions);
+
+    game_graph<SIZE> g(wm, true, seed_filename, COMPACT_ALG_POTENTIALS, high);
+    if (!seed_filename.empty()) {
+        check_seed<SIZE>(g, seed_filename);
+    }
+    prepare_schedule<SIZE>(g);
+
+    // The ratio is kept as an integer multiple of 1 / MULTIPLIER. Invariant: lo_units is infeasible
+    // (or below the range) and hi_units is feasible.
+    int64_t lo_units = (int64_t) std::floor(low * MULTIPLIER) - 1;
+    int64_t hi_units = (int64_t) std::ceil(high * MULTIPLIER);
+    if (!potentials_stabilize<SIZE>(g, telemetry.get())) {
+        fprintf(stdout, "No algorithm of this class for any ratio up to %Lf.\n", high);
+        return 0;
+    }
+    std::vector<short> feasible_potentials;
+    g.save_potentials(feasible_potentials);
+
+    while (hi_units - lo_units > 1) {
+        int64_t mid_units = lo_units + (hi_units - lo_units) / 2;
+        long double mid = (long double) mid_units / MULTIPLIER;
+        g.set_ratio(mid);
+        g.load_potentials(feasible_potentials);
+        if (GRAPH_SCHEDULE == update_schedule::worklist) {
+            g.mark_all_dirty();
+        }
+
+        bool feasible = potentials_stabilize<SIZE>(g, telemetry.get());
+        fprintf(stderr, "Ratio %Lf: %s.\n", mid, feasible ? "feasible" : "infeasible");
+        if (feasible) {
+            hi_units = mid_units;
+            g.save_potentials(feasible_potentials);
+        } else {
+            lo_units = mid_units;
+        }
+    }
+
+    fprintf(stdout, "The smallest ratio in the range for which the potentials stabilize is %Lf.\n",
+            (long double) hi_units / MULTIPLIER);
+    return 0;
+}
+
+template <short SIZE> int dispatch_size(const driver_options& opts) {
+    if constexpr (SIZE > MAX_RUNTIME_SIZE) {
+        PRINT_AND_ABORT("List size %hd is not supported, the largest one is %hd.\n", opts.size, MAX_RUNTIME_SIZE);
+        return 1;
+    } else {
+        if (opts.size == SIZE) {
+            if (opts.low_ratio == opts.high_ratio) {
+                return algorithm_against_opt<SIZE>(opts);
+            }
+            return ratio_search<SIZE>(opts);
+        }
+        return dispatch_size<SIZE + 1>(opts);
+    }
+}
+
+int main(int argc, char** argv) {
+    driver_options opts;
+    int arg = 1;
+    if (argc >= 3) {
+        opts.size = (short) atoi(argv[arg++]);
+        if (strcmp(argv[arg], "--search") == 0 && argc >= 5) {
+            opts.low_ratio = strtold(argv[arg + 1], nullptr);
+            opts.high_ratio = strtold(argv[arg + 2], nullptr);
+            arg += 3;
+        } else {
+            opts.low_ratio = opts.high_ratio = strtold(argv[arg++], nullptr);
+        }
+        while (arg < argc) {
+            if (strcmp(argv[arg], "--seed") == 0 && arg + 1 < argc) {
+                opts.seed_filename = argv[arg + 1];
+                arg += 2;
+            } else if (strcmp(argv[arg], "--checkpoint") == 0 && arg + 1 < argc) {
+                opts.checkpoint_interval = std::chrono::seconds(atoll(argv[arg + 1]));
+                arg += 2;
+            } else if (strcmp(argv[arg], "--telemetry") == 0 && arg + 1 < argc) {
+                opts.telemetry_filename = argv[arg + 1];
+                arg += 2;
+            } else if (strcmp(argv[arg], "--resume") == 0) {
+                opts.resume = true;
+                arg++;
+            } else {
+                break;
+            }
+        }
+    }
+    if (arg != argc || argc < 3) {
+        fprintf(stderr, "Usage: %s LIST_SIZE RATIO [--seed GRAPH_FILE] [--checkpoint SECONDS] [--resume]"
+                " [--telemetry JSONL_FILE]\n", argv[0]);
+        fprintf(stderr, "       %s LIST_SIZE --search LOW_RATIO HIGH_RATIO [--seed GRAPH_FILE]"
+                " [--telemetry JSONL_FILE]\n", argv[0]);
+        return 1;
+    }
+    if (opts.size < MIN_RUNTIME_SIZE || opts.low_ratio <= 0 || opts.high_ratio < opts.low_ratio) {
+        PRINT_AND_ABORT("Invalid list size %s or ratios.\n", argv[1]);
+    }
+    return dispatch_size<MIN_RUNTIME_SIZE>(opts);
+}
@@ -27,11 +27,11 @@ int main(void) {
     }
 
     wfm.initialize_reachable(pairwise_workfunctions_binary_filename);
-    uint64_t rchbl = wfm.reachable_wfs.size();
+    uint64_t rchbl = wfm.reachable_workfunctions;
     fprintf(stderr, "Reachable: %" PRIu64 ".\n", rchbl);
 
 
-    pairwise_game_graph<TESTSIZE> g(wfm, *pg);
+    pairwise_game_graph<TESTSIZE> g(wfm, *pg, COMPACT_ALG_POTENTIALS);
     bool anything_updated = true;
     uint64_t iter_count = 0;
     while(anything_updated) {
@@ -55,6 +55,9 @@ int main(void) {
         iter_count++;
     }
 
+    if (g.alg_compact != nullptr) {
+        g.alg_compact->report("ALG");
+    }
     fprintf(stdout, "The potentials have stabilized with min potential 0.\n");
     // wfm.print_reachable(workfunctions_filename);
     // g.print_potential(potentials_filename);
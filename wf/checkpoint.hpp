@@ -0,0 +1,135 @@
+#pragma once
+
+#include <chrono>
+#include <thread>
+#include "game_graph.hpp"
+
+// Periodic checkpoints of a long potential iteration, from which it can be resumed after it is killed.
+//
+// A checkpoint holds the potentials between two rounds, which determine all later rounds (the worklist
+// is rebuilt by marking every vertex dirty), along with the index of the next round and the last three
+// maximizers. The potentials are copied between rounds and written by a background thread, under
+// a temporary name which is renamed once the file is synced, so a crash leaves the previous checkpoint intact.
+// Compact ALG potentials are copied in their compact form and only expanded to shorts block by block
+// while writing, so the copy costs the memory of the ADV potentials and of the compact ALG potentials.
+//
+// Sections: the ADV potentials, the ALG potentials, their provenance, the next round and the last three
+// maximizers (empty if there are none).
+
+template <short SIZE> class potential_checkpoint {
+public:
+    std::string filename;
+    std::chrono::seconds interval;
+    std::chrono::steady_clock::time_point last_save;
+
+    // The copies being written by the background thread; the ALG potentials are in alg_compact
+    // if the graph keeps them compact.
+    std::vector<short> adv_potentials;
+    std::vector<short> alg_potentials;
+    block_potentials* alg_compact = nullptr;
+    std::vector<request_set> last_three;
+    graph_provenance provenance{};
+    uint64_t algsize = 0;
+    std::thread writer;
+
+    potential_checkpoint(const std::string& fname, std::chrono::seconds inter)
+        : filename(fname), interval(inter), last_save(std::chrono::steady_clock::now()) {}
+
+    potential_checkpoint(const potential_checkpoint&) = delete;
+    potential_checkpoint& operator=(const potential_checkpoint&) = delete;
+
+    ~potential_checkpoint() {
+        wait();
+        delete alg_compact;
+    }
+
+    void wait() {
+        if (writer.joinable()) {
+            writer.join();
+        }
+    }
+
+    // To be called between two rounds.
+    void maybe_save(const game_graph<SIZE>& g, uint64_t next_round) {
+        if (std::chrono::steady_clock::now() - last_save >= interval) {
+            save(g, next_round);
+        }
+    }
+
+    void save(const game_graph<SIZE>& g, uint64_t next_round) {
+        // The copies are reused, so the previous write must be done.
+        wait();
+        adv_potentials.assign(g.adv_vertices, g.adv_vertices + g.advsize);
+        if (g.alg_compact != nullptr) {
+            if (alg_compact == nullptr) {
+                alg_compact = new block_potentials(g.algsize, g.alg_compact->block_size, g.alg_compact->unit);
+            }
+            alg_compact->copy_from(*g.alg_compact);
+        } else {
+            alg_potentials.assign(g.alg_vertices, g.alg_vertices + g.algsize);
+        }
+        last_three.clear();
+        if (g.last_three_maximizers != nullptr) {
+            last_three.assign(g.last_three_maximizers, g.last_three_maximizers + g.advsize);
+        }
+        provenance = graph_provenance{(double) g.ratio, (int32_t) g.alg_move_class};
+        algsize = g.algsize;
+        last_save = std::chrono::steady_clock::now();
+
+        writer = std::thread([this, next_round] {
+            sectioned_file_writer file(filename, {adv_potentials.size() * sizeof(short), algsize * sizeof(short),
+                                                  sizeof(graph_provenance), sizeof(uint64_t),
+                                                  last_three.size() * sizeof(request_set)});
+            file.write(0, adv_potentials.data(), adv_potentials.size() * sizeof(short));
+            if (alg_compact != nullptr) {
+                std::vector<short> block(alg_compact->block_size);
+                for (uint64_t start = 0; start < algsize; start += block.size()) {
+                    for (uint64_t i = 0; i < block.size(); i++) {
+                        block[i] = alg_compact->get(start + i);
+                    }
+                    file.write(1, block.data(), block.size() * sizeof(short));
+                }
+            } else {
+                file.write(1, alg_potentials.data(), algsize * sizeof(short));
+            }
+            file.write(2, &provenance, sizeof(provenance));
+            file.write(3, &next_round, sizeof(next_round));
+            file.write(4, last_three.data(), last_three.size() * sizeof(request_set));
+            file.close();
+            fprintf(stderr, "Checkpoint before round %" PRIu64 " written to %s.\n", next_round, filename.c_str());
+        });
+    }
+
+    // Loads the potentials and the last three maximizers of the checkpoint into the graph,
+    // which must have the same ratio and ALG moves. Returns the round to continue from.
+    static uint64_t resume(game_graph<SIZE>& g, const std::string& filename) {
+        mapped_file checkpoint(filename, false);
+        if (checkpoint.sections() != 5 || checkpoint.elements<short>(0) != g.advsize ||
+            checkpoint.elements<short>(1) != g.algsize) {
+            PRINT_AND_ABORT("The checkpoint %s does not match the game graph.\n", filename.c_str());
+        }
+        const graph_provenance& provenance = *checkpoint.section<graph_provenance>(2);
+        if (provenance.ratio != (double) g.ratio || provenance.moves != (int32_t) g.alg_move_class) {
+            PRINT_AND_ABORT("The checkpoint %s is for the ratio %lf and other ALG moves.\n",
+                            filename.c_str(), provenance.ratio);
+        }
+
+        const short* adv_section = checkpoint.section<short>(0);
+        const short* alg_section = checkpoint.section<short>(1);
+        std::vector<short> pots(adv_section, adv_section + g.advsize);
+        pots.insert(pots.end(), alg_section, alg_section + g.algsize);
+        g.load_potentials(pots);
+
+        if (checkpoint.elements<request_set>(4) == g.advsize) {
+            if (g.last_three_maximizers == nullptr) {
+                g.init_last_three();
+            }
+            const request_set* saved = checkpoint.section<request_set>(4);
+            std::copy(saved, saved + g.advsize, g.last_three_maximizers);
+        }
+
+        uint64_t next_round = *checkpoint.section<uint64_t>(3);
+        fprintf(stderr, "Resuming from %s before round %" PRIu64 ".\n", filename.c_str(), next_round);
+        return next_round;
+    }
+};
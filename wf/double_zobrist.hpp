@@ -41,7 +41,7 @@ public:
             double_hashed_el ret{};
             for (int i = 0; i < factorial[SIZE]; i++) {
                 ret.first_part ^= zobrist_first[i][wf->vals[i]];
-                ret.second_part ^= zobrist_first[i][wf->vals[i]];
+                ret.second_part ^= zobrist_second[i][wf->vals[i]];
             }
             return ret;
     }
@@ -1,15 +1,90 @@
 #pragma once
 
 #include <omp.h>
+#include <atomic>
+#include <bit>
+#include <climits>
+#include <numeric>
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
 #include "../wf_manager.hpp"
 #include "../digraph.hpp"
+#include "../data_structures/block_potentials.hpp"
+#include "../data_structures/rank_bitmap.hpp"
+#include "adv_kernels.hpp"
+
+// Classes of ALG moves, mirroring the update_alg_* variants. Used by the worklist mode,
+// which needs to know the moves in advance to build the reverse edges.
+enum class alg_moves {
+    all,
+    stay_or_mtf,
+    single_swap,
+    request_moves_forward
+};
+
+// Whether every ALG move of the class b is also a move of the class a.
+constexpr bool alg_moves_contain(alg_moves a, alg_moves b) {
+    return a == b || a == alg_moves::all ||
+           (a == alg_moves::request_moves_forward && b == alg_moves::stay_or_mtf);
+}
+
+// Stored in the graph files next to the potentials, so that they can seed later runs.
+struct graph_provenance {
+    double ratio = 0;
+    int32_t moves = -1;
+    int32_t reserved = 0;
+};
+
+// The reachable subgraph of the decision search, with the vertices numbered by their rank among
+// the reachable ones. The edges of both sides are stored forward, with their costs, and backward,
+// so that a re-solve only revisits the vertices whose successors changed.
+struct decision_subgraph {
+    static constexpr uint32_t NO_VERTEX = std::numeric_limits<uint32_t>::max();
+
+    std::vector<uint64_t> adv_index{};
+    // The requests allowed by the OPT decisions, one bit per request.
+    std::vector<uint8_t> adv_allowed{};
+    // Per ADV vertex and request, the ALG vertex and the cost, or NO_VERTEX if it is not reachable.
+    std::vector<uint32_t> adv_moves{};
+    std::vector<short> adv_costs{};
+    // The moves of each ALG vertex into the minima of WFA, in the CSR format.
+    std::vector<uint64_t> alg_offsets{};
+    std::vector<uint32_t> alg_targets{};
+    std::vector<short> alg_costs{};
+    // The reverse edges: the ALG vertices moving into each ADV vertex and vice versa.
+    std::vector<uint64_t> adv_predecessor_offsets{};
+    std::vector<uint32_t> adv_predecessors{};
+    std::vector<uint64_t> alg_predecessor_offsets{};
+    std::vector<uint32_t> alg_predecessors{};
+
+    // Builds the reverse CSR lists of the edges (source, target): the sources of the edges into each target.
+    static void reverse(uint64_t vertices, const std::vector<std::pair<uint32_t, uint32_t>>& edges,
+                        std::vector<uint64_t>& offsets, std::vector<uint32_t>& sources) {
+        offsets.assign(vertices + 1, 0);
+        for (auto [source, target] : edges) {
+            offsets[target + 1]++;
+        }
+        for (uint64_t v = 0; v < vertices; v++) {
+            offsets[v + 1] += offsets[v];
+        }
+        sources.resize(edges.size());
+        std::vector<uint64_t> fill(offsets.begin(), offsets.end() - 1);
+        for (auto [source, target] : edges) {
+            sources[fill[target]++] = source;
+        }
+    }
+};
 
 template <short SIZE> class game_graph {
+    static_assert(SIZE <= 8, "The requests of a list must fit into a request_set.");
 private:
     bool *alg_vertices_visited = nullptr;
     bool *adv_vertices_visited = nullptr;
 public:
     short *alg_vertices = nullptr;
+    // If set, the ALG potentials are stored here in a compressed form instead of alg_vertices.
+    block_potentials *alg_compact = nullptr;
     uint64_t algsize = 0;
     short *adv_vertices = nullptr;
     uint64_t advsize = 0;
@@ -17,37 +92,186 @@ public:
 
     bool wfa_adjacencies = false;
 
+    // The competitive ratio which scales the ADV costs. Only adv_cost() depends on it, so it may be
+    // changed between two fixpoint computations on the same graph.
+    long double ratio = RATIO;
+    // The class of ALG moves the potentials are computed for, set by init_alg_moves().
+    alg_moves alg_move_class = alg_moves::request_moves_forward;
+    // The ratio and the moves of the potentials loaded from a graph file, if the file records them.
+    std::optional<graph_provenance> loaded_provenance{};
+
+    // The numbers of ADV and ALG potentials changed by the last update, for the telemetry.
+    // Set by the updates used by the driver: update_adv(), update_adv_vectorized(),
+    // update_alg_request_moves_forward(), the worklist updates and gauss_seidel_update().
+    uint64_t adv_changes = 0;
+    uint64_t alg_changes = 0;
+
+    // The min ADV potential (over all or over the reachable vertices), if known without a pass over
+    // adv_vertices. The ADV sweeps compute it by a reduction along the way, and the worklist mode keeps
+    // the counts of the ADV vertices with each potential. Every other write of the ADV potentials
+    // must call forget_adv_min().
+    mutable std::optional<short> known_adv_min{};
+    mutable std::optional<short> known_reachable_adv_min{};
+    std::vector<uint64_t> adv_value_counts{};
+
+    void forget_adv_min() {
+        known_adv_min.reset();
+        known_reachable_adv_min.reset();
+        adv_value_counts.clear();
+    }
+
+    void set_adv_min(short m) {
+        forget_adv_min();
+        known_adv_min = m;
+    }
+
+    void set_reachable_adv_min(short m) {
+        forget_adv_min();
+        known_reachable_adv_min = m;
+    }
+
     short* wfa_minimum_values = nullptr;
-    std::array<int8_t, 3>* last_three_maximizers = nullptr;
+    // The last (up to) three requests which maximized the potential of each ADV vertex.
+    request_set* last_three_maximizers = nullptr;
 
-    // Used for making OPT choices out of a list of three possible choices.
+    // Used for making OPT choices out of a set of (up to) three possible choices.
     // The three is arbitrary, comes from the previous heuristic of last three maximizers.
-    std::unordered_map<uint64_t, std::array<int8_t, 3>> opt_decision_map{};
+    // One entry per reachable ADV vertex, in the order of adv_reachable; see opt_decision().
+    std::vector<request_set> opt_decisions{};
 
     // For reachability purposes.
     // For general lower bound computations, all vertices are reachable, so this is useless. However,
     // if we only wish to explore some weaker OPT or specific subgraph, then this comes into play.
+    // The reachable vertices are bitmaps over all ADV and ALG vertices, scanned in the order of the indices.
     uint64_t reachable_advsize = 0;
     uint64_t reachable_algsize = 0;
-    uint64_t* adv_vertices_reachable = nullptr;
-    uint64_t* alg_vertices_reachable = nullptr;
+    rank_bitmap adv_reachable{};
+    rank_bitmap alg_reachable{};
+    // Built from the reachable vertices and the OPT decisions by build_decision_subgraph().
+    decision_subgraph decision_graph{};
+
+    // Worklist mode. The reverse edges of the game graph, stored in the CSR format.
+    // For each pair (work function, request), the list of work functions which move into it under the request.
+    std::vector<uint64_t> reverse_adjacency_offsets{};
+    std::vector<unsigned int> reverse_adjacency{};
+    // For each pair (permutation, request), the list of permutations ALG may move into.
+    std::vector<uint64_t> alg_move_offsets{};
+    std::vector<unsigned int> alg_move_targets{};
+    // For each permutation, the list of pairs (permutation, request) from which ALG may move into it,
+    // encoded as perm_index * SIZE + request.
+    std::vector<uint64_t> reverse_alg_move_offsets{};
+    std::vector<unsigned int> reverse_alg_move_sources{};
+    // Bitmaps of vertices which need to be re-evaluated in the next half-round.
+    uint64_t* adv_dirty = nullptr;
+    uint64_t* alg_dirty = nullptr;
+
+    // The kernel used by update_adv_vectorized(), selected by the CPU features at runtime.
+    adv_block_kernel<SIZE> adv_kernel = nullptr;
+    const char* adv_kernel_name = nullptr;
+
+    // Precomputed costs of ALG moves, indexed by (perm_from * SIZE + req) * factorial[SIZE] + perm_to,
+    // so that the costs of all moves from one ALG vertex are contiguous. Null if the table is disabled.
+    short* alg_cost_table = nullptr;
+
+    // Arrays loaded from sectioned files point into these mappings instead of owning their memory.
+    // The potentials and the last three maximizers are mapped privately, as they are updated in place.
+    mapped_file* graph_mapping = nullptr;
+    mapped_file* reachable_mapping = nullptr;
+    mapped_file* last_three_mapping = nullptr;
+
+    inline short alg_potential(uint64_t index) const {
+        if (alg_compact != nullptr) {
+            return alg_compact->get(index);
+        }
+        return alg_vertices[index];
+    }
+
+    inline void set_alg_potential(uint64_t index, short pot) {
+        if (alg_compact != nullptr) {
+            alg_compact->set(index, pot);
+        } else {
+            alg_vertices[index] = pot;
+        }
+    }
+
+    // Must be called after every pass which writes ALG potentials, before they are read again.
+    void consolidate_alg_potentials() {
+        if (alg_compact != nullptr) {
+            alg_compact->consolidate();
+        }
+    }
+
+    // All potentials are sums of edge costs, so they are multiples of the gcd of all edge costs.
+    short potential_unit() {
+        short unit = MULTIPLIER;
+        for (uint64_t wf_index = 0; wf_index < wf.reachable_workfunctions; wf_index++) {
+            for (short r = 0; r < SIZE; r++) {
+                unit = std::gcd(unit, adv_cost(wf_index, r));
+            }
+        }
+        return unit;
+    }
 
     void reset_potentials() {
-        for (int i = 0; i < algsize; i++) {
-            alg_vertices[i] = 0;
+        if (alg_compact != nullptr) {
+            alg_compact->reset();
+        } else {
+            for (int i = 0; i < algsize; i++) {
+                alg_vertices[i] = 0;
+            }
         }
 
         for (int i = 0; i < advsize; i++) {
             adv_vertices[i] = 0;
         }
+        forget_adv_min();
+    }
+
+
+    // Copies all potentials, the ADV ones first, for restoring them later by load_potentials().
+    void save_potentials(std::vector<short>& out) const {
+        out.resize(advsize + algsize);
+        std::copy(adv_vertices, adv_vertices + advsize, out.begin());
+        for (uint64_t i = 0; i < algsize; i++) {
+            out[advsize + i] = alg_potential(i);
+        }
     }
 
+    void load_potentials(const std::vector<short>& in) {
+        assert(in.size() == advsize + algsize);
+        std::copy(in.begin(), in.begin() + advsize, adv_vertices);
+        forget_adv_min();
+        for (uint64_t i = 0; i < algsize; i++) {
+            set_alg_potential(i, in[advsize + i]);
+            // Consolidated block by block, as when loading a graph file.
+            if (alg_compact != nullptr && (i + 1) % alg_compact->block_size == 0) {
+                consolidate_alg_potentials();
+            }
+        }
+        consolidate_alg_potentials();
+    }
 
-    explicit game_graph(wf_manager<SIZE> &w, bool wfa_adj = false, const std::string& binary_loadfile = "") : wf(w), wfa_adjacencies(wfa_adj) {
+    explicit game_graph(wf_manager<SIZE> &w, bool wfa_adj = false, const std::string& binary_loadfile = "",
+                        bool compact_alg = false, long double r = RATIO) : wf(w), wfa_adjacencies(wfa_adj), ratio(r) {
+        // A sectioned graph file is used in place, so there is nothing to allocate.
+        const bool map_graph = !compact_alg && !binary_loadfile.empty() && mapped_file::is_sectioned(binary_loadfile);
         advsize = wf.reachable_workfunctions * factorial[SIZE];
-        adv_vertices = new short[advsize];
         algsize = wf.reachable_workfunctions * factorial[SIZE] * SIZE;
-        alg_vertices = new short[algsize];
+        if (!map_graph) {
+            adv_vertices = new short[advsize];
+        }
+        if (compact_alg) {
+            // One block per work function.
+            alg_compact = new block_potentials(algsize, factorial[SIZE] * SIZE, potential_unit());
+        } else if (!map_graph) {
+            // Padded by one, as the vectorized ADV kernels may read one short past the end.
+            alg_vertices = new short[algsize + 1];
+            alg_vertices[algsize] = 0;
+        }
+        adv_kernel = select_adv_block_kernel<SIZE>(&adv_kernel_name);
+        if (SIZE <= ALG_COST_TABLE_MAX_SIZE) {
+            init_alg_cost_table();
+        }
 
         if (wfa_adjacencies) {
             wfa_minimum_values = new short[advsize];
@@ -63,25 +287,62 @@ public:
 
     ~game_graph()
     {
-        delete[] adv_vertices;
-        delete[] alg_vertices;
+        if (graph_mapping == nullptr) {
+            delete[] adv_vertices;
+            delete[] alg_vertices;
+        }
+        delete graph_mapping;
+        delete alg_compact;
         if (wfa_adjacencies)
         {
             delete[] wfa_minimum_values;
         }
 
-        delete[] last_three_maximizers;
-        delete[] adv_vertices_reachable;
-        delete[] alg_vertices_reachable;
+        if (last_three_mapping == nullptr) {
+            delete[] last_three_maximizers;
+        }
+        delete last_three_mapping;
+        delete reachable_mapping;
+        delete[] adv_dirty;
+        delete[] alg_dirty;
+        free(alg_cost_table);
     }
 
 
     void init_last_three() {
-        last_three_maximizers = new std::array<int8_t, 3>[advsize];
-        for (int i = 0; i < advsize; i++) {
-            last_three_maximizers[i][0] = -1;
-            last_three_maximizers[i][1] = -1;
-            last_three_maximizers[i][2] = -1;
+        free_last_three();
+        last_three_maximizers = new request_set[advsize];
+        std::fill(last_three_maximizers, last_three_maximizers + advsize, 0);
+    }
+
+    void free_last_three() {
+        if (last_three_mapping != nullptr) {
+            delete last_three_mapping;
+            last_three_mapping = nullptr;
+        } else {
+            delete[] last_three_maximizers;
+        }
+        last_three_maximizers = nullptr;
+    }
+
+    // Prints a set of requests as a list.
+    static void print_request_set(request_set set) {
+        fprintf(stderr, "[");
+        bool first = true;
+        for (int8_t r = 0; r < SIZE; r++) {
+            if (request_set_contains(set, r)) {
+                fprintf(stderr, first ? "%" PRIi8 : ",%" PRIi8, r);
+                first = false;
+            }
+        }
+        fprintf(stderr, "]");
+    }
+
+    void print_first_request_sets(const char* name, const request_set* sets, uint64_t count) const {
+        for (uint64_t i = 0; i < std::min<uint64_t>(count, 3); i++) {
+            fprintf(stderr, "%s %" PRIu64 ": ", name, i);
+            print_request_set(sets[i]);
+            fprintf(stderr, ".\n");
         }
     }
 
@@ -92,33 +353,20 @@ public:
         if (written != 1) {
             PRINT_AND_ABORT("ADVSIZE was not written correctly.");
         }
-        std::array<int8_t, 3>* decisions_indexed_by_reachability = nullptr;
-        decisions_indexed_by_reachability = new std::array<int8_t, 3>[reachable_advsize];
-        for (int i = 0; i < reachable_advsize; i++) {
-            uint64_t index = adv_vertices_reachable[i];
-            decisions_indexed_by_reachability[i] = opt_decision_map[index];
-        }
-
-        written = fwrite(decisions_indexed_by_reachability, sizeof(std::array<int8_t, 3>), reachable_advsize,
-            binary_file);
+        assert(opt_decisions.size() == reachable_advsize);
+        written = fwrite(opt_decisions.data(), sizeof(request_set), reachable_advsize, binary_file);
         if (written != reachable_advsize) {
             PRINT_AND_ABORT("The decision array was not written correctly.");
         }
 
         fclose(binary_file);
         fprintf(stderr, "Serialized %" PRIu64 " decisions.\n", reachable_advsize);
-
-        fprintf(stderr, "Dec 0: %" PRIi8 ", %" PRIi8 ", %" PRIi8 ".\n",
-            decisions_indexed_by_reachability[0][0], decisions_indexed_by_reachability[0][1], decisions_indexed_by_reachability[0][2]);
-        fprintf(stderr, "Dec 1: %" PRIi8 ", %" PRIi8 ", %" PRIi8 ".\n",
-            decisions_indexed_by_reachability[0][0], decisions_indexed_by_reachability[0][1], decisions_indexed_by_reachability[0][2]);
-        fprintf(stderr, "Dec 2: %" PRIi8 ", %" PRIi8 ", %" PRIi8 ".\n",
-            decisions_indexed_by_reachability[0][0], decisions_indexed_by_reachability[0][1], decisions_indexed_by_reachability[0][2]);
-
-        delete[] decisions_indexed_by_reachability;
+        print_first_request_sets("Dec", opt_decisions.data(), reachable_advsize);
     }
 
+    // Also reads the older files with three requests per decision, which are converted.
     void deserialize_decisions(const std::string& decisions_filename) {
+        const uint64_t file_size = std::filesystem::file_size(decisions_filename);
         FILE *binary_file = fopen(decisions_filename.c_str(), "rb");
         size_t read = 0;
         uint64_t reachable_advsize_check = 0;
@@ -128,59 +376,43 @@ public:
         }
         assert(reachable_advsize == reachable_advsize_check);
 
-        std::array<int8_t, 3>* decisions_indexed_by_reachability = nullptr;
-        decisions_indexed_by_reachability = new std::array<int8_t, 3>[reachable_advsize];
-        read = fread(decisions_indexed_by_reachability, sizeof(std::array<int8_t, 3>), reachable_advsize,
-            binary_file);
+        opt_decisions.resize(reachable_advsize);
+        if (file_size == sizeof(uint64_t) + reachable_advsize * sizeof(std::array<int8_t, 3>)) {
+            std::vector<std::array<int8_t, 3>> triples(reachable_advsize);
+            read = fread(triples.data(), sizeof(std::array<int8_t, 3>), reachable_advsize, binary_file);
+            std::transform(triples.begin(), triples.end(), opt_decisions.begin(), request_set_from_triple);
+        } else {
+            read = fread(opt_decisions.data(), sizeof(request_set), reachable_advsize, binary_file);
+        }
         if (read != reachable_advsize) {
             PRINT_AND_ABORT("The decision array was not read correctly.");
         }
 
         fclose(binary_file);
-        opt_decision_map.clear();
-        for (int i = 0; i < reachable_advsize; i++) {
-            uint64_t index = adv_vertices_reachable[i];
-            opt_decision_map[index] = decisions_indexed_by_reachability[i];
-        }
 
         fprintf(stderr, "Deserialized %" PRIu64 " decisions.\n", reachable_advsize);
-
-        fprintf(stderr, "Dec 0: %" PRIi8 ", %" PRIi8 ", %" PRIi8 ".\n",
-            decisions_indexed_by_reachability[0][0], decisions_indexed_by_reachability[0][1], decisions_indexed_by_reachability[0][2]);
-        fprintf(stderr, "Dec 1: %" PRIi8 ", %" PRIi8 ", %" PRIi8 ".\n",
-            decisions_indexed_by_reachability[0][0], decisions_indexed_by_reachability[0][1], decisions_indexed_by_reachability[0][2]);
-        fprintf(stderr, "Dec 2: %" PRIi8 ", %" PRIi8 ", %" PRIi8 ".\n",
-            decisions_indexed_by_reachability[0][0], decisions_indexed_by_reachability[0][1], decisions_indexed_by_reachability[0][2]);
-
-        delete[] decisions_indexed_by_reachability;
+        print_first_request_sets("Dec", opt_decisions.data(), reachable_advsize);
     }
 
     void serialize_last_three(const std::string& last_three_filename) const {
-
-        FILE* binary_file = fopen(last_three_filename.c_str(), "wb");
-        size_t written = 0;
-        written = fwrite(&advsize, sizeof(uint64_t), 1, binary_file);
-        if (written != 1) {
-            PRINT_AND_ABORT("ADVSIZE was not written correctly.");
-        }
-        written = fwrite(last_three_maximizers, sizeof(std::array<int8_t, 3>), advsize, binary_file);
-        if (written != advsize) {
-            PRINT_AND_ABORT("The last three choices array was not written correctly.");
-        }
-
-        fclose(binary_file);
-
-        fprintf(stderr, "0: %" PRIi8 ", %" PRIi8 ", %" PRIi8 ".\n",
-            last_three_maximizers[0][0], last_three_maximizers[0][1], last_three_maximizers[0][2]);
-        fprintf(stderr, "1: %" PRIi8 ", %" PRIi8 ", %" PRIi8 ".\n",
-            last_three_maximizers[1][0], last_three_maximizers[1][1], last_three_maximizers[2][2]);
-        fprintf(stderr, "2: %" PRIi8 ", %" PRIi8 ", %" PRIi8 ".\n",
-            last_three_maximizers[2][0], last_three_maximizers[2][1], last_three_maximizers[2][2]);
-
+        const uint64_t bytes = advsize * sizeof(request_set);
+        sectioned_file_writer writer(last_three_filename, {bytes});
+        writer.write(0, last_three_maximizers, bytes);
+        writer.close();
+        print_first_request_sets("Last three", last_three_maximizers, advsize);
     }
 
+    // The unsectioned files store three requests per ADV vertex and are converted. Sectioned files
+    // in that format can be converted once with last-three-to-sets-conv.cpp, so they can be mapped again.
     void deserialize_last_three(const std::string& last_three_filename) {
+        if (mapped_file::is_sectioned(last_three_filename)) {
+            map_last_three(last_three_filename);
+            return;
+        }
 
+        if (last_three_maximizers == nullptr) {
+            init_last_three();
+        }
         FILE* binary_file = fopen(last_three_filename.c_str(), "rb");
         size_t read = 0;
         uint64_t advsize_check = 0;
@@ -190,18 +422,28 @@ public:
         }
         assert(advsize_check == advsize);
 
-        read = fread(last_three_maximizers, sizeof(std::array<int8_t, 3>), advsize, binary_file);
+        std::vector<std::array<int8_t, 3>> triples(advsize);
+        read = fread(triples.data(), sizeof(std::array<int8_t, 3>), advsize, binary_file);
         if (read != advsize) {
             PRINT_AND_ABORT("The last three choices array was not read correctly.");
         }
         fclose(binary_file);
+        std::transform(triples.begin(), triples.end(), last_three_maximizers, request_set_from_triple);
+        print_first_request_sets("Last three", last_three_maximizers, advsize);
+    }
 
-        fprintf(stderr, "0: %" PRIi8 ", %" PRIi8 ", %" PRIi8 ".\n",
-            last_three_maximizers[0][0], last_three_maximizers[0][1], last_three_maximizers[0][2]);
-        fprintf(stderr, "1: %" PRIi8 ", %" PRIi8 ", %" PRIi8 ".\n",
-            last_three_maximizers[1][0], last_three_maximizers[1][1], last_three_maximizers[2][2]);
-        fprintf(stderr, "2: %" PRIi8 ", %" PRIi8 ", %" PRIi8 ".\n",
-            last_three_maximizers[2][0], last_three_maximizers[2][1], last_three_maximizers[2][2]);
+    void map_last_three(const std::string& last_three_filename) {
+        free_last_three();
+        last_three_mapping = new mapped_file(last_three_filename, true);
+        if (last_three_mapping->elements<request_set>(0) == advsize * sizeof(std::array<int8_t, 3>)) {
+            PRINT_AND_ABORT("The last three choices in %s are stored as three requests each; "
+                            "convert them with last-three-to-sets-conv.cpp.\n", last_three_filename.c_str());
+        }
+        if (last_three_mapping->elements<request_set>(0) != advsize) {
+            PRINT_AND_ABORT("The last three choices in %s do not match ADVSIZE.\n", last_three_filename.c_str());
+        }
+        last_three_maximizers = last_three_mapping->section<request_set>(0);
+        print_first_request_sets("Last three", last_three_maximizers, 1);
     }
 
     std::pair<unsigned long int, unsigned long int> decode_adv(uint64_t index) const {
@@ -220,10 +462,22 @@ public:
         return {wf_index, perm_index, request_index};
     }
 
-    uint64_t encode_alg(unsigned long int wf_index, unsigned long int perm_index, unsigned long int request_index) {
+    uint64_t encode_alg(unsigned long int wf_index, unsigned long int perm_index, unsigned long int request_index) const {
         return wf_index * factorial[SIZE] * SIZE + perm_index * SIZE + request_index;
     }
 
+    // The ALG vertex into which ADV moves from the vertex (wf_index, perm_index) by requesting r.
+    // With canonical orbits, the adjacent work function is stored only as its orbit representative,
+    // so ALG's permutation and the request are relabeled into the frame of the representative.
+    uint64_t adv_move(unsigned long int wf_index, unsigned long int perm_index, short r) const {
+        if (!wf.canonical) {
+            return encode_alg(wf.adjacency(wf_index, r), perm_index, r);
+        }
+        const uint64_t relabeling = wf.relabeling(wf_index, r);
+        return encode_alg(wf.adjacency(wf_index, r), wf.pm.quick_compose_right(relabeling, perm_index),
+                          wf.pm.all_perms[relabeling].data[r]);
+    }
+
     void print_adv(uint64_t index) const {
         auto [wf_index, perm_index] = decode_adv(index);
         fprintf(stderr, "WF index %lu, perm_index %lu.\n", wf_index, perm_index);
@@ -240,44 +494,141 @@ public:
         // wf.reachable_wfs[wf_index].print();
     }
 
-    short adv_cost(unsigned int wf_index, short req) {
-        return RATIO*MULTIPLIER*wf.update_cost(wf_index, req);
+    short adv_cost(unsigned int wf_index, short req) const {
+        return ratio*MULTIPLIER*wf.update_cost(wf_index, req);
     }
 
-    short alg_cost(unsigned int perm_index_one, unsigned int perm_index_two, short req) {
+    // The compact ALG potentials are stored in units of the edge costs. If the costs for the new ratio are not
+    // multiples of that unit, the potentials are re-encoded in the gcd of the old unit and the new one, which
+    // divides both the current potentials and all potentials the new costs can produce.
+    void set_ratio(long double r) {
+        ratio = r;
+        if (alg_compact != nullptr && potential_unit() % alg_compact->unit != 0) {
+            reencode_alg_compact(std::gcd(alg_compact->unit, potential_unit()));
+        }
+    }
+
+    // Copies the compact ALG potentials into a new compact array with the given unit, block by block;
+    // the unit must divide all the potentials. Both arrays are held at once while copying.
+    void reencode_alg_compact(short unit) {
+        block_potentials* reencoded = new block_potentials(algsize, alg_compact->block_size, unit);
+        for (uint64_t start = 0; start < algsize; start += reencoded->block_size) {
+            for (uint64_t i = 0; i < reencoded->block_size; i++) {
+                reencoded->set(start + i, alg_compact->get(start + i));
+            }
+            reencoded->consolidate();
+        }
+        fprintf(stderr, "Compact ALG potentials re-encoded from the unit %hd to %hd.\n", alg_compact->unit, unit);
+        delete alg_compact;
+        alg_compact = reencoded;
+    }
+
+    short alg_cost(unsigned int perm_index_one, unsigned int perm_index_two, short req) const {
+        if (alg_cost_table != nullptr) {
+            return alg_cost_table[(perm_index_one * SIZE + req) * factorial[SIZE] + perm_index_two];
+        }
         const permutation<SIZE>& perm_one = wf.pm.all_perms[perm_index_one];
         const permutation<SIZE>* perm_two = &(wf.pm.all_perms[perm_index_two]);
         return MULTIPLIER*(perm_one.position(req) + perm_one.inversions_wrt(perm_two));
     }
 
-
-    void write_graph_binary(const std::string& filename) {
-        FILE* binary_file = fopen(filename.c_str(), "wb");
-        size_t written = 0;
-        written = fwrite(&advsize, sizeof(uint64_t), 1, binary_file);
-        if (written != 1) {
-            PRINT_AND_ABORT("ADVSIZE was not written correctly.");
+    // Tabulates alg_cost() for all pairs of permutations and all requests. The table has
+    // factorial[SIZE]^2 * SIZE entries, which is 6 MB for SIZE=6, but 355 MB for SIZE=7.
+    void init_alg_cost_table() {
+        const uint64_t entries = factorial[SIZE] * factorial[SIZE] * SIZE;
+        const uint64_t bytes = ((entries * sizeof(short) + 63) / 64) * 64;
+        short* table = static_cast<short*>(std::aligned_alloc(64, bytes));
+        if (table == nullptr) {
+            PRINT_AND_ABORT("The ALG cost table could not be allocated.");
         }
-        written = fwrite(&algsize, sizeof(uint64_t), 1, binary_file);
-        if (written != 1) {
-            PRINT_AND_ABORT("ALGSIZE was not written correctly.");
+#pragma omp parallel for
+        for (uint64_t perm_from = 0; perm_from < factorial[SIZE]; perm_from++) {
+            for (short req = 0; req < SIZE; req++) {
+                for (uint64_t perm_to = 0; perm_to < factorial[SIZE]; perm_to++) {
+                    table[(perm_from * SIZE + req) * factorial[SIZE] + perm_to] = alg_cost(perm_from, perm_to, req);
+                }
+            }
         }
+        alg_cost_table = table;
+        fprintf(stderr, "ALG cost table: %" PRIu64 " entries, %" PRIu64 " KB.\n", entries, bytes / 1024);
+    }
 
-        written = fwrite(adv_vertices, sizeof(short), advsize, binary_file);
-        if (written != advsize) {
-            PRINT_AND_ABORT("The adversary potential array was not written correctly.");
-        }
-        written = fwrite(alg_vertices, sizeof(short), algsize, binary_file);
-        if (written != algsize) {
-            PRINT_AND_ABORT("The algorithm potential array was not written correctly.");
+
+    // Sections: the ADV potentials, the ALG potentials and their provenance.
+    void write_graph_binary(const std::string& filename) {
+        sectioned_file_writer writer(filename, {advsize * sizeof(short), algsize * sizeof(short),
+                                                sizeof(graph_provenance)});
+        writer.write(0, adv_vertices, advsize * sizeof(short));
+        if (alg_compact != nullptr) {
+            // Decompress one block at a time.
+            std::vector<short> block(alg_compact->block_size);
+            for (uint64_t start = 0; start < algsize; start += block.size()) {
+                for (uint64_t i = 0; i < block.size(); i++) {
+                    block[i] = alg_compact->get(start + i);
+                }
+                writer.write(1, block.data(), block.size() * sizeof(short));
+            }
+        } else {
+            writer.write(1, alg_vertices, algsize * sizeof(short));
         }
+        graph_provenance provenance{(double) ratio, (int32_t) alg_move_class};
+        writer.write(2, &provenance, sizeof(provenance));
+        writer.close();
 
         fprintf(stderr, "Written %" PRIu64 " ADV vertices and %" PRIu64 " ALG vertices into the binary file.\n",
         advsize, algsize);
-        fclose(binary_file);
+    }
+
+    // The potentials are mapped privately and updated in place; the padding after the ALG section
+    // provides the extra element read by the vectorized ADV kernels. Compact ALG potentials are
+    // copied out of the mapping, which is then dropped.
+    void map_graph_binary(const std::string& filename) {
+        mapped_file* mapping = new mapped_file(filename, true);
+        // Older sectioned files have no provenance.
+        if (mapping->sections() != 2 && mapping->sections() != 3) {
+            PRINT_AND_ABORT("The graph file %s should have two or three sections.\n", filename.c_str());
+        }
+        loaded_provenance.reset();
+        if (mapping->sections() == 3) {
+            loaded_provenance = *mapping->section<graph_provenance>(2);
+        }
+        advsize = mapping->elements<short>(0);
+        algsize = mapping->elements<short>(1);
+        fprintf(stderr, "Binary file contains %" PRIu64 " ADV vertices and %" PRIu64 " ALG vertices.\n",
+            advsize, algsize);
+
+        if (graph_mapping == nullptr) {
+            delete[] adv_vertices;
+            delete[] alg_vertices;
+        }
+        delete graph_mapping;
+        graph_mapping = mapping;
+        adv_vertices = mapping->section<short>(0);
+        forget_adv_min();
+
+        if (alg_compact != nullptr) {
+            const short* alg_section = mapping->section<short>(1);
+            for (uint64_t start = 0; start < algsize; start += alg_compact->block_size) {
+                for (uint64_t i = 0; i < alg_compact->block_size; i++) {
+                    alg_compact->set(start + i, alg_section[start + i]);
+                }
+                alg_compact->consolidate();
+            }
+            madvise(mapping->section<short>(1), algsize * sizeof(short), MADV_DONTNEED);
+        } else {
+            alg_vertices = mapping->section<short>(1);
+        }
     }
 
     void load_graph_binary(const std::string& filename) {
+        if (mapped_file::is_sectioned(filename)) {
+            map_graph_binary(filename);
+            return;
+        }
+
+        loaded_provenance.reset();
+
+        // The unversioned format: both sizes followed by both arrays.
         FILE* binary_file = fopen(filename.c_str(), "rb");
         size_t read = 0;
         read = fread(&advsize, sizeof(uint64_t), 1, binary_file);
@@ -294,14 +645,88 @@ public:
         if (read != advsize) {
             PRINT_AND_ABORT("The adversary potential array was not read correctly.");
         }
-        read = fread(alg_vertices, sizeof(short), algsize, binary_file);
-        if (read != algsize) {
-            PRINT_AND_ABORT("The algorithm potential array was not read correctly.");
+        forget_adv_min();
+        if (alg_compact != nullptr) {
+            std::vector<short> block(alg_compact->block_size);
+            for (uint64_t start = 0; start < algsize; start += block.size()) {
+                read = fread(block.data(), sizeof(short), block.size(), binary_file);
+                if (read != block.size()) {
+                    PRINT_AND_ABORT("The algorithm potential array was not read correctly.");
+                }
+                for (uint64_t i = 0; i < block.size(); i++) {
+                    alg_compact->set(start + i, block[i]);
+                }
+                alg_compact->consolidate();
+            }
+        } else {
+            read = fread(alg_vertices, sizeof(short), algsize, binary_file);
+            if (read != algsize) {
+                PRINT_AND_ABORT("The algorithm potential array was not read correctly.");
+            }
         }
 
         fclose(binary_file);
     }
 
+    // Checks that the loaded potentials are a valid starting point for the current ratio and the given
+    // ALG moves, so that iterating from them reaches the same verdict as iterating from zero.
+    //
+    // The potentials must come from a fixpoint with at least the current ratio and with a class of ALG moves
+    // containing the given one, that is, at least the given moves. Both only make the ADV costs higher and
+    // the ALG choices wider, which can only lower the fixpoint, so the loaded potentials lie below the one
+    // we are after. As a check of the file itself, no potential may decrease in the first update, which also
+    // makes the updates from there monotone.
+    bool valid_warm_start(alg_moves moves) {
+        if (advsize != wf.reachable_workfunctions * factorial[SIZE] || algsize != advsize * SIZE) {
+            fprintf(stderr, "Warm start: the potentials do not match the reachable work functions.\n");
+            return false;
+        }
+        if (!loaded_provenance.has_value()) {
+            fprintf(stderr, "Warm start: the graph file does not record its ratio and ALG moves.\n");
+            return false;
+        }
+        if (loaded_provenance->ratio < (double) ratio) {
+            fprintf(stderr, "Warm start: the potentials are for the ratio %lf, below %Lf.\n",
+                    loaded_provenance->ratio, ratio);
+            return false;
+        }
+        if (!alg_moves_contain((alg_moves) loaded_provenance->moves, moves)) {
+            fprintf(stderr, "Warm start: the potentials are for a narrower class of ALG moves.\n");
+            return false;
+        }
+
+        std::vector<std::vector<unsigned int>> targets(factorial[SIZE] * SIZE);
+        for (unsigned int perm_index = 0; perm_index < factorial[SIZE]; perm_index++) {
+            for (short req = 0; req < SIZE; req++) {
+                targets[perm_index * SIZE + req] = alg_moves_from(perm_index, req, moves);
+            }
+        }
+
+        uint64_t decreasing = 0;
+#pragma omp parallel for reduction(+:decreasing)
+        for (uint64_t index = 0; index < advsize; index++) {
+            auto [wf_index, perm_index] = decode_adv(index);
+            short new_pot = std::numeric_limits<short>::min();
+            for (int r = 0; r < SIZE; r++) {
+                new_pot = std::max<short>(new_pot, alg_potential(adv_move(wf_index, perm_index, r)) - adv_cost(wf_index, r));
+            }
+            decreasing += adv_vertices[index] > new_pot;
+        }
+#pragma omp parallel for reduction(+:decreasing)
+        for (uint64_t index = 0; index < algsize; index++) {
+            auto [wf_index, perm_index, req] = decode_alg(index);
+            short new_pot = std::numeric_limits<short>::max();
+            for (unsigned int p : targets[perm_index * SIZE + req]) {
+                new_pot = std::min<short>(new_pot, adv_vertices[encode_adv(wf_index, p)] + alg_cost(perm_index, p, req));
+            }
+            decreasing += alg_potential(index) > new_pot;
+        }
+
+        fprintf(stderr, "Warm start from ratio %lf: %" PRIu64 " potentials would decrease.\n",
+                loaded_provenance->ratio, decreasing);
+        return decreasing == 0;
+    }
+
     /*
     short min_adv_potential() {
         short m = std::numeric_limits<short>::max();
@@ -313,25 +738,39 @@ public:
      */
 
     short min_adv_potential() const {
+        if (known_adv_min.has_value()) {
+            return *known_adv_min;
+        }
         short m = std::numeric_limits<short>::max();
+#pragma omp parallel for reduction(min:m)
         for (uint64_t index = 0; index < advsize; index++) {
             m = std::min(m, adv_vertices[index]);
         }
+        known_adv_min = m;
         return m;
     }
 
     short reachable_min_adv_potential() const {
+        if (known_reachable_adv_min.has_value()) {
+            return *known_reachable_adv_min;
+        }
         short m = std::numeric_limits<short>::max();
-        for ( int i = 0; i < reachable_advsize; i++) {
-            m = std::min(m, adv_vertices[adv_vertices_reachable[i]]);
+#pragma omp parallel for reduction(min:m) schedule(dynamic, 256)
+        for (uint64_t word = 0; word < adv_reachable.words; word++) {
+            uint64_t bits = adv_reachable.data[word];
+            while (bits != 0) {
+                m = std::min(m, adv_vertices[word * 64 + std::countr_zero(bits)]);
+                bits &= bits - 1;
+            }
         }
+        known_reachable_adv_min = m;
         return m;
     }
 
     unsigned int wfa_cost(unsigned long wf_index, unsigned long current_alg_index, unsigned long perm_index) const {
-        permutation<LISTSIZE>* perm = &(wf.pm.all_perms[perm_index]);
-        // permutation<LISTSIZE>* current_alg_pos = &(wf.pm.all_perms[current_alg_index]);
-        unsigned int wf_cost = wf.reachable_wfs[wf_index].vals[perm_index];
+        permutation<SIZE>* perm = &(wf.pm.all_perms[perm_index]);
+        // permutation<SIZE>* current_alg_pos = &(wf.pm.all_perms[current_alg_index]);
+        unsigned int wf_cost = wf.reachable_wfs_arr[wf_index].vals[perm_index];
         // unsigned int transition_cost =  perm->inversions_wrt(current_alg_pos);
         unsigned int quick_transition_cost = wf.pm.quick_inversion_wrt(perm_index, current_alg_index);
         // assert(quick_transition_cost == transition_cost);
@@ -340,8 +779,8 @@ public:
 
     unsigned int workfunction_algorithm_minimum(unsigned long wf_index, unsigned long perm_index) const {
         unsigned int minimum_wfa_cost = std::numeric_limits<unsigned int>::max();
-        permutation<LISTSIZE>* current_alg_pos = &(wf.pm.all_perms[perm_index]);
-        for (unsigned int i = 0; i < factorial[LISTSIZE]; i++) {
+        permutation<SIZE>* current_alg_pos = &(wf.pm.all_perms[perm_index]);
+        for (unsigned int i = 0; i < factorial[SIZE]; i++) {
             unsigned int cost_for_i = wfa_cost(wf_index, perm_index, i);
             if (cost_for_i < minimum_wfa_cost) {
                 minimum_wfa_cost = cost_for_i;
@@ -352,8 +791,9 @@ public:
     }
 
     bool update_adv() {
-        bool any_potential_changed = false;
-#pragma omp parallel for
+        uint64_t changed = 0;
+        short adv_min = std::numeric_limits<short>::max();
+#pragma omp parallel for reduction(+:changed) reduction(min:adv_min)
         for (uint64_t index = 0; index < advsize; index++) {
             auto [wf_index, perm_index] = decode_adv(index);
             if(GRAPH_DEBUG) {
@@ -364,24 +804,24 @@ public:
             // workfunction<SIZE> wf_before_move = wf.reachable_wfs[wf_index];
             short new_pot = std::numeric_limits<short>::min();
             for (int r = 0; r < SIZE; r++) {
-                uint64_t new_wf_index = wf.adjacency(wf_index, r);
-                uint64_t alg_index = encode_alg(new_wf_index, perm_index, r);
+                uint64_t alg_index = adv_move(wf_index, perm_index, r);
                 short adv_cost_s = adv_cost(wf_index, r);
                 if(GRAPH_DEBUG) {
                     fprintf(stderr, "ADV vertex %" PRIu64 " has request %d associated with cost %hd.\n",
                             index, r, adv_cost_s);
                     // ADV potential update.
                     fprintf(stderr, "Phi_x (%hd) - d_yx (%hd) = %hd.\n",
-                            alg_vertices[alg_index], adv_cost_s,
-                            alg_vertices[alg_index] - adv_cost_s);
+                            alg_potential(alg_index), adv_cost_s,
+                            alg_potential(alg_index) - adv_cost_s);
                 }
-                if (alg_vertices[alg_index] - adv_cost_s > new_pot) {
-                    new_pot = alg_vertices[alg_index] - adv_cost_s;
+                if (alg_potential(alg_index) - adv_cost_s > new_pot) {
+                    new_pot = alg_potential(alg_index) - adv_cost_s;
                 }
             }
 
+            adv_min = std::min(adv_min, new_pot);
             if (adv_vertices[index] != new_pot) {
-                any_potential_changed = true;
+                changed++;
                 if(GRAPH_DEBUG) {
                     fprintf(stderr, "ADV vertex %" PRIu64 " changed its potential from %hd to %hd.\n",
                             index, adv_vertices[index], new_pot);
@@ -389,14 +829,51 @@ public:
                 adv_vertices[index] = new_pot;
             }
         }
-        return any_potential_changed;
+        adv_changes = changed;
+        set_adv_min(adv_min);
+        return changed > 0;
+    }
+
+    // Equivalent to update_adv(), but processes all ADV vertices of a work function at once
+    // by the vectorized kernel. Falls back to update_adv() for the compact ALG storage and canonical orbits.
+    bool update_adv_vectorized() {
+        // The kernels rely on the ALG vertices of an adjacent work function not being relabeled.
+        if (alg_compact != nullptr || wf.canonical) {
+            return update_adv();
+        }
+        uint64_t changed = 0;
+        short adv_min = std::numeric_limits<short>::max();
+#pragma omp parallel for reduction(+:changed) reduction(min:adv_min)
+        for (uint64_t wf_index = 0; wf_index < wf.reachable_workfunctions; wf_index++) {
+            std::array<const short*, SIZE> sources;
+            std::array<short, SIZE> costs;
+            for (int r = 0; r < SIZE; r++) {
+                sources[r] = alg_vertices + encode_alg(wf.adjacency(wf_index, r), 0, r);
+                costs[r] = adv_cost(wf_index, r);
+            }
+            std::array<short, factorial[SIZE]> new_pots;
+            adv_kernel(sources, costs, new_pots.data());
+
+            short* block = adv_vertices + encode_adv(wf_index, 0);
+            for (uint64_t perm_index = 0; perm_index < factorial[SIZE]; perm_index++) {
+                adv_min = std::min(adv_min, new_pots[perm_index]);
+                if (block[perm_index] != new_pots[perm_index]) {
+                    block[perm_index] = new_pots[perm_index];
+                    changed++;
+                }
+            }
+        }
+        adv_changes = changed;
+        set_adv_min(adv_min);
+        return changed > 0;
     }
 
     bool update_adv_save_last_three(const uint64_t iteration) {
         bool any_potential_changed = false;
         const uint64_t iteration_mod_three = iteration % 3;
 
-#pragma omp parallel for
+        short adv_min = std::numeric_limits<short>::max();
+#pragma omp parallel for reduction(||:any_potential_changed) reduction(min:adv_min)
         for (uint64_t index = 0; index < advsize; index++) {
             auto [wf_index, perm_index] = decode_adv(index);
 
@@ -405,31 +882,29 @@ public:
             short new_pot = std::numeric_limits<short>::min();
             int8_t maximizer_request = -1;
             for (int8_t r = 0; r < SIZE; r++) {
-                uint64_t new_wf_index = wf.adjacency(wf_index, r);
-                uint64_t alg_index = encode_alg(new_wf_index, perm_index, r);
+                uint64_t alg_index = adv_move(wf_index, perm_index, r);
                 short adv_cost_s = adv_cost(wf_index, r);
 
-                if (alg_vertices[alg_index] - adv_cost_s > new_pot) {
-                    new_pot = alg_vertices[alg_index] - adv_cost_s;
+                if (alg_potential(alg_index) - adv_cost_s > new_pot) {
+                    new_pot = alg_potential(alg_index) - adv_cost_s;
                     maximizer_request = r;
                 }
             }
 
+            adv_min = std::min(adv_min, new_pot);
             if (adv_vertices[index] != new_pot) {
                 any_potential_changed = true;
 
-                // Store the last three choices here, cyclically.
-                // Note that this is not strictly last three maximizers, because in principle
-                // the second-to-last maximizer can be overwritten. To store the actual last three, we would need
-                // a fourth digit in the list for each index (namely, the last written-to position).
-
-                if (!triple_contains(&last_three_maximizers[index], maximizer_request)) {
-                    last_three_maximizers[index][iteration_mod_three] = maximizer_request;
-                }
+                // Store the last three choices here, cyclically, see request_set_save_maximizer(). Note that
+                // this is not strictly last three maximizers, because in principle the second-to-last maximizer
+                // can be replaced. To store the actual last three, we would need their order as well.
+                last_three_maximizers[index] = request_set_save_maximizer(last_three_maximizers[index],
+                                                                          maximizer_request, iteration_mod_three);
 
                 adv_vertices[index] = new_pot;
             }
         }
+        set_adv_min(adv_min);
         return any_potential_changed;
     }
 
@@ -437,7 +912,8 @@ public:
     bool update_adv_only_use_last_three(const uint64_t _) {
         bool any_potential_changed = false;
 
-#pragma omp parallel for
+        short adv_min = std::numeric_limits<short>::max();
+#pragma omp parallel for reduction(||:any_potential_changed) reduction(min:adv_min)
         for (uint64_t index = 0; index < advsize; index++) {
             auto [wf_index, perm_index] = decode_adv(index);
 
@@ -445,55 +921,62 @@ public:
             short new_pot = std::numeric_limits<short>::min();
             for (int8_t r = 0; r < SIZE; r++) {
                 // Skip any choice that is not the last three.
-                if (!triple_contains(&last_three_maximizers[index], r)) {
+                if (!request_set_contains(last_three_maximizers[index], r)) {
                     continue;
                 }
-                uint64_t new_wf_index = wf.adjacency(wf_index, r);
-                uint64_t alg_index = encode_alg(new_wf_index, perm_index, r);
+                uint64_t alg_index = adv_move(wf_index, perm_index, r);
                 short adv_cost_s = adv_cost(wf_index, r);
 
-                if (alg_vertices[alg_index] - adv_cost_s > new_pot) {
-                    new_pot = alg_vertices[alg_index] - adv_cost_s;
+                if (alg_potential(alg_index) - adv_cost_s > new_pot) {
+                    new_pot = alg_potential(alg_index) - adv_cost_s;
                 }
             }
 
+            adv_min = std::min(adv_min, new_pot);
             if (adv_vertices[index] != new_pot) {
                 any_potential_changed = true;
                 adv_vertices[index] = new_pot;
             }
         }
+        set_adv_min(adv_min);
         return any_potential_changed;
     }
 
 
     bool reachable_update_adv_only_use_last_three(const uint64_t _) {
         bool any_potential_changed = false;
-#pragma omp parallel for
-        for (uint64_t reachable_index = 0; reachable_index < reachable_advsize; reachable_index++) {
-            uint64_t index = adv_vertices_reachable[reachable_index];
-            auto [wf_index, perm_index] = decode_adv(index);
+        short adv_min = std::numeric_limits<short>::max();
+#pragma omp parallel for reduction(||:any_potential_changed) reduction(min:adv_min) schedule(dynamic, 256)
+        for (uint64_t word = 0; word < adv_reachable.words; word++) {
+            uint64_t bits = adv_reachable.data[word];
+            while (bits != 0) {
+                uint64_t index = word * 64 + std::countr_zero(bits);
+                bits &= bits - 1;
+                auto [wf_index, perm_index] = decode_adv(index);
 
-            // workfunction<SIZE> wf_before_move = wf.reachable_wfs[wf_index];
-            short new_pot = std::numeric_limits<short>::min();
-            for (int8_t r = 0; r < SIZE; r++) {
-                // Skip any choice that is not the last three.
-                if (!triple_contains(&last_three_maximizers[index], r)) {
-                    continue;
-                }
-                uint64_t new_wf_index = wf.adjacency(wf_index, r);
-                uint64_t alg_index = encode_alg(new_wf_index, perm_index, r);
-                short adv_cost_s = adv_cost(wf_index, r);
+                // workfunction<SIZE> wf_before_move = wf.reachable_wfs[wf_index];
+                short new_pot = std::numeric_limits<short>::min();
+                for (int8_t r = 0; r < SIZE; r++) {
+                    // Skip any choice that is not the last three.
+                    if (!request_set_contains(last_three_maximizers[index], r)) {
+                        continue;
+                    }
+                    uint64_t alg_index = adv_move(wf_index, perm_index, r);
+                    short adv_cost_s = adv_cost(wf_index, r);
 
-                if (alg_vertices[alg_index] - adv_cost_s > new_pot) {
-                    new_pot = alg_vertices[alg_index] - adv_cost_s;
+                    if (alg_potential(alg_index) - adv_cost_s > new_pot) {
+                        new_pot = alg_potential(alg_index) - adv_cost_s;
+                    }
                 }
-            }
 
-            if (adv_vertices[index] != new_pot) {
-                any_potential_changed = true;
-                adv_vertices[index] = new_pot;
+                adv_min = std::min(adv_min, new_pot);
+                if (adv_vertices[index] != new_pot) {
+                    any_potential_changed = true;
+                    adv_vertices[index] = new_pot;
+                }
             }
         }
+        set_reachable_adv_min(adv_min);
         return any_potential_changed;
     }
 
@@ -501,33 +984,41 @@ public:
 
     bool reachable_linear_update_adv_opt_decisions() {
         bool any_potential_changed = false;
-        for (uint64_t reachable_index = 0; reachable_index < reachable_advsize; reachable_index++) {
-            uint64_t index = adv_vertices_reachable[reachable_index];
-            auto [wf_index, perm_index] = decode_adv(index);
+        short adv_min = std::numeric_limits<short>::max();
+        assert(opt_decisions.size() == reachable_advsize);
+        uint64_t reachable_index = 0;
+        for (uint64_t word = 0; word < adv_reachable.words; word++) {
+            uint64_t bits = adv_reachable.data[word];
+            while (bits != 0) {
+                uint64_t index = word * 64 + std::countr_zero(bits);
+                bits &= bits - 1;
+                auto [wf_index, perm_index] = decode_adv(index);
+                const request_set decision = opt_decisions[reachable_index++];
 
-            // workfunction<SIZE> wf_before_move = wf.reachable_wfs[wf_index];
-            short new_pot = std::numeric_limits<short>::min();
-            for (int8_t r = 0; r < SIZE; r++) {
-                // Skip any choice that is not in the opt decision map.
-                assert(opt_decision_map.contains(index));
-                if (!triple_contains(&(opt_decision_map[index]), r)) {
-                    continue;
-                }
+                // workfunction<SIZE> wf_before_move = wf.reachable_wfs[wf_index];
+                short new_pot = std::numeric_limits<short>::min();
+                for (int8_t r = 0; r < SIZE; r++) {
+                    // Skip any choice that is not among the OPT decisions.
+                    if (!request_set_contains(decision, r)) {
+                        continue;
+                    }
 
-                uint64_t new_wf_index = wf.adjacency(wf_index, r);
-                uint64_t alg_index = encode_alg(new_wf_index, perm_index, r);
-                short adv_cost_s = adv_cost(wf_index, r);
+                    uint64_t alg_index = adv_move(wf_index, perm_index, r);
+                    short adv_cost_s = adv_cost(wf_index, r);
 
-                if (alg_vertices[alg_index] - adv_cost_s > new_pot) {
-                    new_pot = alg_vertices[alg_index] - adv_cost_s;
+                    if (alg_potential(alg_index) - adv_cost_s > new_pot) {
+                        new_pot = alg_potential(alg_index) - adv_cost_s;
+                    }
                 }
-            }
 
-            if (adv_vertices[index] != new_pot) {
-                any_potential_changed = true;
-                adv_vertices[index] = new_pot;
+                adv_min = std::min(adv_min, new_pot);
+                if (adv_vertices[index] != new_pot) {
+                    any_potential_changed = true;
+                    adv_vertices[index] = new_pot;
+                }
             }
         }
+        set_reachable_adv_min(adv_min);
         return any_potential_changed;
     }
 
@@ -535,7 +1026,7 @@ public:
 
     bool update_alg() {
         bool any_potential_changed = false;
-#pragma omp parallel for
+#pragma omp parallel for reduction(||:any_potential_changed)
         for (uint64_t index = 0; index < algsize; index++) {
             auto [wf_index, perm_index, req] = decode_alg(index);
             if(GRAPH_DEBUG) {
@@ -561,24 +1052,25 @@ public:
                 }
             }
 
-            if (alg_vertices[index] != new_pot) {
+            if (alg_potential(index) != new_pot) {
                 any_potential_changed = true;
                 if(GRAPH_DEBUG) {
                     fprintf(stderr, "ALG vertex %" PRIu64 " changed its potential from %hd to %hd.\n",
-                            index, alg_vertices[index], new_pot);
+                            index, alg_potential(index), new_pot);
                 }
-                alg_vertices[index] = new_pot;
+                set_alg_potential(index, new_pot);
 
             }
         }
 
+        consolidate_alg_potentials();
         return any_potential_changed;
     }
 
 
     bool update_alg_wfa() {
         bool any_potential_changed = false;
-#pragma omp parallel for
+#pragma omp parallel for reduction(||:any_potential_changed)
         for (uint64_t index = 0; index < algsize; index++) {
             auto [wf_index, perm_index, req] = decode_alg(index);
             short new_pot = std::numeric_limits<short>::max();
@@ -603,17 +1095,18 @@ public:
                 }
             }
 
-            if (alg_vertices[index] != new_pot) {
+            if (alg_potential(index) != new_pot) {
                 any_potential_changed = true;
                 if(GRAPH_DEBUG) {
                     fprintf(stderr, "ALG vertex %" PRIu64 " changed its potential from %hd to %hd.\n",
-                            index, alg_vertices[index], new_pot);
+                            index, alg_potential(index), new_pot);
                 }
-                alg_vertices[index] = new_pot;
+                set_alg_potential(index, new_pot);
 
             }
         }
 
+        consolidate_alg_potentials();
         return any_potential_changed;
     }
 
@@ -622,7 +1115,7 @@ public:
     {
         fprintf(stderr, "Building work function minima.\n");
         bool any_potential_changed = false;
-#pragma omp parallel for
+#pragma omp parallel for reduction(||:any_potential_changed)
         for (uint64_t index = 0; index < advsize; index++)
         {
             // This looks weird but all such positions have the same WFA adjacency and minimum.
@@ -638,7 +1131,7 @@ public:
 
     bool update_alg_wfa_faster() {
         bool any_potential_changed = false;
-#pragma omp parallel for
+#pragma omp parallel for reduction(||:any_potential_changed)
         for (uint64_t index = 0; index < algsize; index++) {
             auto [wf_index, perm_index, req] = decode_alg(index);
             short new_pot = std::numeric_limits<short>::max();
@@ -663,17 +1156,18 @@ public:
                 }
             }
 
-            if (alg_vertices[index] != new_pot) {
+            if (alg_potential(index) != new_pot) {
                 any_potential_changed = true;
                 if(GRAPH_DEBUG) {
                     fprintf(stderr, "ALG vertex %" PRIu64 " changed its potential from %hd to %hd.\n",
-                            index, alg_vertices[index], new_pot);
+                            index, alg_potential(index), new_pot);
                 }
-                alg_vertices[index] = new_pot;
+                set_alg_potential(index, new_pot);
 
             }
         }
 
+        consolidate_alg_potentials();
         return any_potential_changed;
     }
 
@@ -681,76 +1175,86 @@ public:
 
     bool reachable_update_alg_wfa_faster() {
         bool any_potential_changed = false;
-#pragma omp parallel for
-        for (uint64_t reachable_index = 0; reachable_index < reachable_algsize; reachable_index++) {
-            uint64_t index = alg_vertices_reachable[reachable_index];
-            auto [wf_index, perm_index, req] = decode_alg(index);
-            short new_pot = std::numeric_limits<short>::max();
+#pragma omp parallel for reduction(||:any_potential_changed) schedule(dynamic, 256)
+        for (uint64_t word = 0; word < alg_reachable.words; word++) {
+            uint64_t bits = alg_reachable.data[word];
+            while (bits != 0) {
+                uint64_t index = word * 64 + std::countr_zero(bits);
+                bits &= bits - 1;
+                auto [wf_index, perm_index, req] = decode_alg(index);
+                short new_pot = std::numeric_limits<short>::max();
 
-            // Instead of any permutation, we filter those which have higher than minimum value of WFA.
-            unsigned int wfa_minimum_value = wfa_minimum_values[encode_adv(wf_index, perm_index)];
-            for (int p = 0; p < factorial[SIZE]; p++) {
-                unsigned int wfa_cost_for_this_index = wfa_cost(wf_index, perm_index, p);
-                if (wfa_cost_for_this_index != wfa_minimum_value) {
-                    continue;
-                }
-                uint64_t target_adv = encode_adv(wf_index, p);
-                short alg_cost_s = alg_cost(perm_index, p, req);
+                // Instead of any permutation, we filter those which have higher than minimum value of WFA.
+                unsigned int wfa_minimum_value = wfa_minimum_values[encode_adv(wf_index, perm_index)];
+                for (int p = 0; p < factorial[SIZE]; p++) {
+                    unsigned int wfa_cost_for_this_index = wfa_cost(wf_index, perm_index, p);
+                    if (wfa_cost_for_this_index != wfa_minimum_value) {
+                        continue;
+                    }
+                    uint64_t target_adv = encode_adv(wf_index, p);
+                    short alg_cost_s = alg_cost(perm_index, p, req);
 
-                // ALG potential update.
-                if(GRAPH_DEBUG) {
-                    fprintf(stderr, "Phi_y (%hd) + c_xy  (%hd) = %hd.\n",
-                            adv_vertices[target_adv], alg_cost_s, adv_vertices[target_adv] + alg_cost_s);
-                }
-                if (adv_vertices[target_adv] + alg_cost_s < new_pot) {
-                    new_pot = adv_vertices[target_adv] + alg_cost_s;
+                    // ALG potential update.
+                    if(GRAPH_DEBUG) {
+                        fprintf(stderr, "Phi_y (%hd) + c_xy  (%hd) = %hd.\n",
+                                adv_vertices[target_adv], alg_cost_s, adv_vertices[target_adv] + alg_cost_s);
+                    }
+                    if (adv_vertices[target_adv] + alg_cost_s < new_pot) {
+                        new_pot = adv_vertices[target_adv] + alg_cost_s;
+                    }
                 }
-            }
 
-            if (alg_vertices[index] != new_pot) {
-                any_potential_changed = true;
-                if(GRAPH_DEBUG) {
-                    fprintf(stderr, "ALG vertex %" PRIu64 " changed its potential from %hd to %hd.\n",
-                            index, alg_vertices[index], new_pot);
-                }
-                alg_vertices[index] = new_pot;
+                if (alg_potential(index) != new_pot) {
+                    any_potential_changed = true;
+                    if(GRAPH_DEBUG) {
+                        fprintf(stderr, "ALG vertex %" PRIu64 " changed its potential from %hd to %hd.\n",
+                                index, alg_potential(index), new_pot);
+                    }
+                    set_alg_potential(index, new_pot);
 
+                }
             }
         }
 
+        consolidate_alg_potentials();
         return any_potential_changed;
     }
 
     bool reachable_linear_update_alg_wfa_faster() {
         bool any_potential_changed = false;
-        for (uint64_t reachable_index = 0; reachable_index < reachable_algsize; reachable_index++) {
-            uint64_t index = alg_vertices_reachable[reachable_index];
-            auto [wf_index, perm_index, req] = decode_alg(index);
-            short new_pot = std::numeric_limits<short>::max();
+        for (uint64_t word = 0; word < alg_reachable.words; word++) {
+            uint64_t bits = alg_reachable.data[word];
+            while (bits != 0) {
+                uint64_t index = word * 64 + std::countr_zero(bits);
+                bits &= bits - 1;
+                auto [wf_index, perm_index, req] = decode_alg(index);
+                short new_pot = std::numeric_limits<short>::max();
 
-            // Instead of any permutation, we filter those which have higher than minimum value of WFA.
-            unsigned int wfa_minimum_value = wfa_minimum_values[encode_adv(wf_index, perm_index)];
-            for (int p = 0; p < factorial[SIZE]; p++) {
-                unsigned int wfa_cost_for_this_index = wfa_cost(wf_index, perm_index, p);
-                if (wfa_cost_for_this_index != wfa_minimum_value) {
-                    continue;
-                }
-                uint64_t target_adv = encode_adv(wf_index, p);
-                short alg_cost_s = alg_cost(perm_index, p, req);
+                // Instead of any permutation, we filter those which have higher than minimum value of WFA.
+                unsigned int wfa_minimum_value = wfa_minimum_values[encode_adv(wf_index, perm_index)];
+                for (int p = 0; p < factorial[SIZE]; p++) {
+                    unsigned int wfa_cost_for_this_index = wfa_cost(wf_index, perm_index, p);
+                    if (wfa_cost_for_this_index != wfa_minimum_value) {
+                        continue;
+                    }
+                    uint64_t target_adv = encode_adv(wf_index, p);
+                    short alg_cost_s = alg_cost(perm_index, p, req);
 
-                // ALG potential update.
-                if (adv_vertices[target_adv] + alg_cost_s < new_pot) {
-                    new_pot = adv_vertices[target_adv] + alg_cost_s;
+                    // ALG potential update.
+                    if (adv_vertices[target_adv] + alg_cost_s < new_pot) {
+                        new_pot = adv_vertices[target_adv] + alg_cost_s;
+                    }
                 }
-            }
 
-            if (alg_vertices[index] != new_pot) {
-                any_potential_changed = true;
-                alg_vertices[index] = new_pot;
+                if (alg_potential(index) != new_pot) {
+                    any_potential_changed = true;
+                    set_alg_potential(index, new_pot);
 
+                }
             }
         }
 
+        consolidate_alg_potentials();
         return any_potential_changed;
     }
 
@@ -774,7 +1278,7 @@ public:
 
     bool update_alg_wfa_unique_only() {
         bool any_potential_changed = false;
-#pragma omp parallel for
+#pragma omp parallel for reduction(||:any_potential_changed)
         for (uint64_t index = 0; index < algsize; index++) {
             auto [wf_index, perm_index, req] = decode_alg(index);
             short new_pot = std::numeric_limits<short>::max();
@@ -799,20 +1303,21 @@ public:
                 new_pot = 0;
             }
 
-            if (alg_vertices[index] != new_pot) {
+            if (alg_potential(index) != new_pot) {
                 any_potential_changed = true;
-                alg_vertices[index] = new_pot;
+                set_alg_potential(index, new_pot);
 
             }
         }
 
+        consolidate_alg_potentials();
         return any_potential_changed;
     }
 
 
     bool update_alg_stay_or_mtf() {
         bool any_potential_changed = false;
-#pragma omp parallel for
+#pragma omp parallel for reduction(||:any_potential_changed)
         for (uint64_t index = 0; index < algsize; index++) {
             auto [wf_index, perm_index, req] = decode_alg(index);
             if(GRAPH_DEBUG) {
@@ -843,23 +1348,24 @@ public:
             }
 
 
-            if (alg_vertices[index] != new_pot) {
+            if (alg_potential(index) != new_pot) {
                 any_potential_changed = true;
                 if(GRAPH_DEBUG) {
                     fprintf(stderr, "ALG vertex %" PRIu64 " changed its potential from %hd to %hd.\n",
-                            index, alg_vertices[index], new_pot);
+                            index, alg_potential(index), new_pot);
                 }
-                alg_vertices[index] = new_pot;
+                set_alg_potential(index, new_pot);
 
             }
         }
 
+        consolidate_alg_potentials();
         return any_potential_changed;
     }
 
     bool update_alg_request_moves_forward() {
-        bool any_potential_changed = false;
-#pragma omp parallel for
+        uint64_t changed = 0;
+#pragma omp parallel for reduction(+:changed)
         for (uint64_t index = 0; index < algsize; index++) {
             auto [wf_index, perm_index, req] = decode_alg(index);
             if(GRAPH_DEBUG) {
@@ -896,23 +1402,25 @@ public:
                 }
             }
 
-            if (alg_vertices[index] != new_pot) {
-                any_potential_changed = true;
+            if (alg_potential(index) != new_pot) {
+                changed++;
                 if(GRAPH_DEBUG) {
                     fprintf(stderr, "ALG vertex %" PRIu64 " changed its potential from %hd to %hd.\n",
-                            index, alg_vertices[index], new_pot);
+                            index, alg_potential(index), new_pot);
                 }
-                alg_vertices[index] = new_pot;
+                set_alg_potential(index, new_pot);
 
             }
         }
 
-        return any_potential_changed;
+        consolidate_alg_potentials();
+        alg_changes = changed;
+        return changed > 0;
     }
 
     bool update_alg_single_swap() {
         bool any_potential_changed = false;
-#pragma omp parallel for
+#pragma omp parallel for reduction(||:any_potential_changed)
         for (uint64_t index = 0; index < algsize; index++) {
             auto [wf_index, perm_index, req] = decode_alg(index);
             if(GRAPH_DEBUG) {
@@ -950,23 +1458,317 @@ public:
                 }
             }
 
-            if (alg_vertices[index] != new_pot) {
+            if (alg_potential(index) != new_pot) {
                 any_potential_changed = true;
                 if(GRAPH_DEBUG) {
                     fprintf(stderr, "ALG vertex %" PRIu64 " changed its potential from %hd to %hd.\n",
-                            index, alg_vertices[index], new_pot);
+                            index, alg_potential(index), new_pot);
                 }
-                alg_vertices[index] = new_pot;
+                set_alg_potential(index, new_pot);
 
             }
         }
 
+        consolidate_alg_potentials();
         return any_potential_changed;
     }
 
+    std::vector<unsigned int> alg_moves_from(unsigned long perm_index, short req, alg_moves moves) const {
+        std::vector<unsigned int> ret;
+        const permutation<SIZE>& perm = wf.pm.all_perms[perm_index];
+        switch (moves) {
+            case alg_moves::all:
+                for (unsigned int p = 0; p < factorial[SIZE]; p++) {
+                    ret.push_back(p);
+                }
+                break;
+            case alg_moves::stay_or_mtf: {
+                ret.push_back(perm_index);
+                unsigned int mtf_perm_index = perm.mtf_copy(req).id();
+                if (mtf_perm_index != perm_index) {
+                    ret.push_back(mtf_perm_index);
+                }
+                break;
+            }
+            case alg_moves::single_swap:
+                ret.push_back(perm_index);
+                for (short swap = 0; swap < SIZE - 1; swap++) {
+                    ret.push_back(perm.swap(swap).id());
+                }
+                break;
+            case alg_moves::request_moves_forward: {
+                short request_pos = perm.position(req);
+                for (short target = 0; target <= request_pos; target++) {
+                    ret.push_back(perm.move_forward_copy(req, target).id());
+                }
+                break;
+            }
+        }
+        return ret;
+    }
+
+    // The average number of ALG moves per ALG vertex in the current class of ALG moves.
+    double average_alg_moves() const {
+        uint64_t moves = alg_move_targets.size();
+        if (alg_move_targets.empty()) {
+            for (unsigned int perm_index = 0; perm_index < factorial[SIZE]; perm_index++) {
+                for (short req = 0; req < SIZE; req++) {
+                    moves += alg_moves_from(perm_index, req, alg_move_class).size();
+                }
+            }
+        }
+        return (double) moves / (factorial[SIZE] * SIZE);
+    }
+
+    static inline void mark_dirty(uint64_t* bitmap, uint64_t index) {
+        std::atomic_ref<uint64_t>(bitmap[index / 64]).fetch_or(1LLU << (index % 64), std::memory_order_relaxed);
+    }
+
+    // Tabulates the ALG moves of the given class, along with the reverse moves.
+    void init_alg_moves(alg_moves moves) {
+        alg_move_class = moves;
+        alg_move_offsets.assign(factorial[SIZE] * SIZE + 1, 0);
+        alg_move_targets.clear();
+        reverse_alg_move_offsets.assign(factorial[SIZE] + 1, 0);
+        for (unsigned int perm_index = 0; perm_index < factorial[SIZE]; perm_index++) {
+            for (short req = 0; req < SIZE; req++) {
+                for (unsigned int target : alg_moves_from(perm_index, req, moves)) {
+                    alg_move_targets.push_back(target);
+                    reverse_alg_move_offsets[target + 1]++;
+                }
+                alg_move_offsets[perm_index * SIZE + req + 1] = alg_move_targets.size();
+            }
+        }
+        for (uint64_t i = 0; i < factorial[SIZE]; i++) {
+            reverse_alg_move_offsets[i + 1] += reverse_alg_move_offsets[i];
+        }
+        reverse_alg_move_sources.resize(alg_move_targets.size());
+        std::vector<uint64_t> fill(reverse_alg_move_offsets.begin(), reverse_alg_move_offsets.end() - 1);
+        for (uint64_t source = 0; source < factorial[SIZE] * SIZE; source++) {
+            for (uint64_t i = alg_move_offsets[source]; i < alg_move_offsets[source + 1]; i++) {
+                reverse_alg_move_sources[fill[alg_move_targets[i]]++] = source;
+            }
+        }
+    }
+
+    // Builds the reverse edges for the worklist mode and marks every vertex as dirty,
+    // so that the first round is a full sweep.
+    void init_worklist(alg_moves moves) {
+        // The reverse edges do not account for the relabelings of canonical orbits.
+        assert(!wf.canonical);
+        const uint64_t wfs = wf.reachable_workfunctions;
+
+        reverse_adjacency_offsets.assign(wfs * SIZE + 1, 0);
+        for (uint64_t wf_index = 0; wf_index < wfs; wf_index++) {
+            for (short r = 0; r < SIZE; r++) {
+                reverse_adjacency_offsets[wf.adjacency(wf_index, r) * SIZE + r + 1]++;
+            }
+        }
+        for (uint64_t i = 0; i < wfs * SIZE; i++) {
+            reverse_adjacency_offsets[i + 1] += reverse_adjacency_offsets[i];
+        }
+        reverse_adjacency.resize(wfs * SIZE);
+        std::vector<uint64_t> fill(reverse_adjacency_offsets.begin(), reverse_adjacency_offsets.end() - 1);
+        for (uint64_t wf_index = 0; wf_index < wfs; wf_index++) {
+            for (short r = 0; r < SIZE; r++) {
+                reverse_adjacency[fill[wf.adjacency(wf_index, r) * SIZE + r]++] = wf_index;
+            }
+        }
+
+        init_alg_moves(moves);
+
+        delete[] adv_dirty;
+        delete[] alg_dirty;
+        adv_dirty = new uint64_t[(advsize + 63) / 64];
+        alg_dirty = new uint64_t[(algsize + 63) / 64];
+        mark_all_dirty();
+
+        fprintf(stderr, "Worklist mode: %zu reverse adjacencies, %zu ALG moves.\n",
+                reverse_adjacency.size(), alg_move_targets.size());
+    }
+
+    // Needed whenever the potentials or the costs change outside of the worklist updates.
+    void mark_all_dirty() {
+        for (uint64_t i = 0; i < (advsize + 63) / 64; i++) {
+            adv_dirty[i] = std::numeric_limits<uint64_t>::max();
+        }
+        for (uint64_t i = 0; i < (algsize + 63) / 64; i++) {
+            alg_dirty[i] = std::numeric_limits<uint64_t>::max();
+        }
+        // Clear the padding bits of the last word.
+        if (advsize % 64 != 0) {
+            adv_dirty[advsize / 64] = (1LLU << (advsize % 64)) - 1;
+        }
+        if (algsize % 64 != 0) {
+            alg_dirty[algsize / 64] = (1LLU << (algsize % 64)) - 1;
+        }
+    }
+
+    void count_adv_values() {
+        adv_value_counts.assign(1 << 16, 0);
+#pragma omp parallel for
+        for (uint64_t index = 0; index < advsize; index++) {
+            std::atomic_ref<uint64_t>(adv_value_counts[adv_vertices[index] - SHRT_MIN]).fetch_add(
+                1, std::memory_order_relaxed);
+        }
+    }
+
+    // The worklist versions of update_adv() and update_alg_*(). Only the dirty vertices are re-evaluated,
+    // and a vertex whose potential changes marks its predecessors dirty for the next half-round.
+    // The potentials evolve exactly as with the full sweeps, as a clean vertex would not change anyway.
+    bool worklist_update_adv() {
+        uint64_t changed = 0;
+        const uint64_t words = (advsize + 63) / 64;
+        if (adv_value_counts.empty()) {
+            count_adv_values();
+        }
+#pragma omp parallel for reduction(+:changed) schedule(dynamic, 256)
+        for (uint64_t word = 0; word < words; word++) {
+            uint64_t bits = adv_dirty[word];
+            if (bits == 0) {
+                continue;
+            }
+            adv_dirty[word] = 0;
+            while (bits != 0) {
+                uint64_t index = word * 64 + std::countr_zero(bits);
+                bits &= bits - 1;
+                auto [wf_index, perm_index] = decode_adv(index);
+                short new_pot = std::numeric_limits<short>::min();
+                for (int r = 0; r < SIZE; r++) {
+                    uint64_t alg_index = encode_alg(wf.adjacency(wf_index, r), perm_index, r);
+                    short adv_cost_s = adv_cost(wf_index, r);
+                    if (alg_potential(alg_index) - adv_cost_s > new_pot) {
+                        new_pot = alg_potential(alg_index) - adv_cost_s;
+                    }
+                }
+
+                if (adv_vertices[index] != new_pot) {
+                    std::atomic_ref<uint64_t>(adv_value_counts[adv_vertices[index] - SHRT_MIN]).fetch_sub(
+                        1, std::memory_order_relaxed);
+                    std::atomic_ref<uint64_t>(adv_value_counts[new_pot - SHRT_MIN]).fetch_add(
+                        1, std::memory_order_relaxed);
+                    adv_vertices[index] = new_pot;
+                    changed++;
+                    for (uint64_t i = reverse_alg_move_offsets[perm_index];
+                         i < reverse_alg_move_offsets[perm_index + 1]; i++) {
+                        uint64_t source = reverse_alg_move_sources[i];
+                        mark_dirty(alg_dirty, encode_alg(wf_index, source / SIZE, source % SIZE));
+                    }
+                }
+            }
+        }
+        adv_changes = changed;
+        known_adv_min = SHRT_MIN;
+        while (adv_value_counts[*known_adv_min - SHRT_MIN] == 0) {
+            (*known_adv_min)++;
+        }
+        known_reachable_adv_min.reset();
+        return changed > 0;
+    }
+
+    bool worklist_update_alg() {
+        uint64_t changed = 0;
+        const uint64_t words = (algsize + 63) / 64;
+#pragma omp parallel for reduction(+:changed) schedule(dynamic, 256)
+        for (uint64_t word = 0; word < words; word++) {
+            uint64_t bits = alg_dirty[word];
+            if (bits == 0) {
+                continue;
+            }
+            alg_dirty[word] = 0;
+            while (bits != 0) {
+                uint64_t index = word * 64 + std::countr_zero(bits);
+                bits &= bits - 1;
+                auto [wf_index, perm_index, req] = decode_alg(index);
+                short new_pot = std::numeric_limits<short>::max();
+                const uint64_t source = perm_index * SIZE + req;
+                for (uint64_t i = alg_move_offsets[source]; i < alg_move_offsets[source + 1]; i++) {
+                    unsigned int p = alg_move_targets[i];
+                    short alg_cost_s = alg_cost(perm_index, p, req);
+                    short target_pot = adv_vertices[encode_adv(wf_index, p)];
+                    if (target_pot + alg_cost_s < new_pot) {
+                        new_pot = target_pot + alg_cost_s;
+                    }
+                }
+
+                if (alg_potential(index) != new_pot) {
+                    set_alg_potential(index, new_pot);
+                    changed++;
+                    for (uint64_t i = reverse_adjacency_offsets[wf_index * SIZE + req];
+                         i < reverse_adjacency_offsets[wf_index * SIZE + req + 1]; i++) {
+                        mark_dirty(adv_dirty, encode_adv(reverse_adjacency[i], perm_index));
+                    }
+                }
+            }
+        }
+        consolidate_alg_potentials();
+        alg_changes = changed;
+        return changed > 0;
+    }
+
+    // A fused Gauss-Seidel round, replacing the pair update_adv() and update_alg_*(). The work functions are
+    // processed one by one; the ADV vertices of a work function are updated first and the ALG vertices of the
+    // same work function immediately after, already using the new ADV potentials. Requires init_alg_moves().
+    // The ADV vertices of a work function are only read by its own ALG vertices, but the ALG potentials are
+    // read across work functions, hence the relaxed atomic accesses to them.
+    bool gauss_seidel_update() {
+        // The compact storage does not allow reading the ALG potentials while they are being written.
+        assert(alg_compact == nullptr);
+        uint64_t changed = 0;
+        uint64_t alg_changed = 0;
+        short adv_min = std::numeric_limits<short>::max();
+#pragma omp parallel for reduction(+:changed, alg_changed) reduction(min:adv_min) schedule(dynamic, 16)
+        for (uint64_t wf_index = 0; wf_index < wf.reachable_workfunctions; wf_index++) {
+            for (uint64_t perm_index = 0; perm_index < factorial[SIZE]; perm_index++) {
+                short new_pot = std::numeric_limits<short>::min();
+                for (int r = 0; r < SIZE; r++) {
+                    uint64_t alg_index = adv_move(wf_index, perm_index, r);
+                    short alg_pot = std::atomic_ref<short>(alg_vertices[alg_index]).load(std::memory_order_relaxed);
+                    short adv_cost_s = adv_cost(wf_index, r);
+                    if (alg_pot - adv_cost_s > new_pot) {
+                        new_pot = alg_pot - adv_cost_s;
+                    }
+                }
+
+                uint64_t index = encode_adv(wf_index, perm_index);
+                adv_min = std::min(adv_min, new_pot);
+                if (adv_vertices[index] != new_pot) {
+                    adv_vertices[index] = new_pot;
+                    changed++;
+                }
+            }
+
+            for (uint64_t source = 0; source < factorial[SIZE] * SIZE; source++) {
+                const uint64_t perm_index = source / SIZE;
+                const short req = source % SIZE;
+                short new_pot = std::numeric_limits<short>::max();
+                for (uint64_t i = alg_move_offsets[source]; i < alg_move_offsets[source + 1]; i++) {
+                    unsigned int p = alg_move_targets[i];
+                    short alg_cost_s = alg_cost(perm_index, p, req);
+                    short target_pot = adv_vertices[encode_adv(wf_index, p)];
+                    if (target_pot + alg_cost_s < new_pot) {
+                        new_pot = target_pot + alg_cost_s;
+                    }
+                }
+
+                // The ALG vertices of a work function are contiguous, so source is also the offset within the block.
+                uint64_t index = encode_alg(wf_index, 0, 0) + source;
+                std::atomic_ref<short> alg_pot(alg_vertices[index]);
+                if (alg_pot.load(std::memory_order_relaxed) != new_pot) {
+                    alg_pot.store(new_pot, std::memory_order_relaxed);
+                    alg_changed++;
+                }
+            }
+        }
+        adv_changes = changed;
+        alg_changes = alg_changed;
+        set_adv_min(adv_min);
+        return changed + alg_changed > 0;
+    }
+
     /*
     short conjectured_potential(unsigned long wf_index, unsigned long perm_index) {
-        workfunction<SIZE>& workf = wf.reachable_wfs[wf_index];
+        workfunction<SIZE>& workf = wf.reachable_wfs_arr[wf_index];
         permutation<SIZE> perm = wf.pm.all_perms[perm_index];
         short m = std::numeric_limits<short>::min();
         for (unsigned long p = 0; p < factorial[SIZE]; p++) {
@@ -990,210 +1792,288 @@ public:
 
 
 
+    void free_reachable_arrays() {
+        decision_graph = decision_subgraph{};
+        opt_decisions.clear();
+        adv_reachable.release();
+        alg_reachable.release();
+        delete reachable_mapping;
+        reachable_mapping = nullptr;
+        reachable_advsize = 0;
+        reachable_algsize = 0;
+    }
+
     void reinitialize_reachable_arrays(const std::unordered_set<uint64_t>& reachable_adv,
         const std::unordered_set<uint64_t> & reachable_alg) {
-        reachable_advsize = reachable_adv.size();
-        reachable_algsize = reachable_alg.size();
-
-        delete[] adv_vertices_reachable;
-        delete[] alg_vertices_reachable;
-        adv_vertices_reachable = new uint64_t[reachable_advsize];
-        alg_vertices_reachable = new uint64_t[reachable_algsize];
-
-        // Serialize the sets into flat arrays (for parallel for purposes).
-        // We lose querying power in the meantime.
-        uint64_t i = 0;
+        free_reachable_arrays();
+        adv_reachable.allocate(advsize);
+        alg_reachable.allocate(algsize);
         for (uint64_t reachable_vertex: reachable_adv) {
-            adv_vertices_reachable[i] = reachable_vertex;
-            i++;
+            adv_reachable.set(reachable_vertex);
         }
-
-        uint64_t j = 0;
         for (uint64_t reachable_vertex: reachable_alg) {
-            alg_vertices_reachable[j] = reachable_vertex;
-            j++;
+            alg_reachable.set(reachable_vertex);
         }
+        finish_reachable_arrays();
     }
 
-    // Compute how many ALG and ADV vertices are reachable via just the last three maximizer moves.
-    void wfa_reachable_via(bool last_three = false) {
-        std::unordered_set<uint64_t> adv_vertices_processed{};
-        std::unordered_set<uint64_t> alg_vertices_processed{};
-
-        std::unordered_set<uint64_t> current_adv{};
-        std::unordered_set<uint64_t> current_alg{};
-
-        // std::unordered_set<uint64_t> next_adv{};
-        // std::unordered_set<uint64_t> next_alg{};
-
-        current_adv.insert(0);
-        // print_adv(0);
-        while (!current_adv.empty()) {
-            for (uint64_t adv_vertex_index : current_adv) {
-                if (adv_vertices_processed.contains(adv_vertex_index)) {
-                    continue;
-                }
-                adv_vertices_processed.insert(adv_vertex_index);
-
-                auto [wf_index, perm_index] = decode_adv(adv_vertex_index);
-
-                // fprintf(stderr, "adv%lu: adv potential %hd.\n", adv_vertex_index, adv_vertices[adv_vertex_index]);
-                // print_adv(adv_vertex_index);
+    void finish_reachable_arrays() {
+        adv_reachable.build_ranks();
+        alg_reachable.build_ranks();
+        reachable_advsize = adv_reachable.count();
+        reachable_algsize = alg_reachable.count();
+        default_opt_decisions();
+    }
 
+    // Every reachable ADV vertex starts with the decision {0}, so the decisions always
+    // match the reachable ADV vertices they are indexed by.
+    void default_opt_decisions() {
+        opt_decisions.assign(reachable_advsize, 1);
+    }
 
-                // wf.reachable_wfs[wf_index].print();
+    // Converts a list of reachable vertex indices, as stored by the older files.
+    static void reachable_from_indices(rank_bitmap& bitmap, uint64_t bits, const uint64_t* indices, uint64_t count) {
+        bitmap.allocate(bits);
+        for (uint64_t i = 0; i < count; i++) {
+            bitmap.set(indices[i]);
+        }
+    }
 
-                short current_pot = adv_vertices[adv_vertex_index];
+    // Appends the vertices found by one thread to the next frontier.
+    static void merge_frontier(std::vector<uint64_t>& frontier, const std::vector<uint64_t>& local) {
+#pragma omp critical
+        frontier.insert(frontier.end(), local.begin(), local.end());
+    }
 
-                for (int8_t r = 0; r < SIZE; r++) {
-                    if (last_three) {
-                        // Skip any choice that is not the last three.
-                        if (!triple_contains(&last_three_maximizers[adv_vertex_index], r)) {
+    // Marks the vertices reachable from the initial ADV vertex, where ADV moves along the requests
+    // for which adv_edge(adv_index, wf_index, perm_index, r) holds and ALG moves into the minima of WFA.
+    // The search goes level by level; each thread collects the newly visited vertices of its part
+    // of the frontier, and the visited bitmaps are shared and set atomically.
+    template <typename ADV_EDGE> void reachable_traversal(rank_bitmap& adv_visited, rank_bitmap& alg_visited,
+                                                          ADV_EDGE adv_edge) {
+        adv_visited.allocate(advsize);
+        alg_visited.allocate(algsize);
+        std::vector<uint64_t> adv_frontier{0};
+        std::vector<uint64_t> alg_frontier{};
+        adv_visited.set(0);
+
+        while (!adv_frontier.empty()) {
+            alg_frontier.clear();
+#pragma omp parallel
+            {
+                std::vector<uint64_t> local{};
+#pragma omp for schedule(dynamic, 64) nowait
+                for (uint64_t i = 0; i < adv_frontier.size(); i++) {
+                    uint64_t adv_index = adv_frontier[i];
+                    auto [wf_index, perm_index] = decode_adv(adv_index);
+                    for (int8_t r = 0; r < SIZE; r++) {
+                        if (!adv_edge(adv_index, wf_index, perm_index, r)) {
                             continue;
                         }
-                    } else {
-                        // Use the opt decision map for testing if we should skip.
-                        if (!triple_contains(&opt_decision_map[adv_vertex_index], r)) {
-                            continue;
+                        uint64_t alg_index = adv_move(wf_index, perm_index, r);
+                        if (alg_visited.insert_atomic(alg_index)) {
+                            local.push_back(alg_index);
                         }
                     }
-
-                    uint64_t new_wf_index = wf.adjacency(wf_index, r);
-                    uint64_t alg_index = encode_alg(new_wf_index, perm_index, r);
-                    // short adv_cost_s = adv_cost(wf_index, r);
-                    if (!alg_vertices_processed.contains(alg_index)) {
-                        current_alg.insert(alg_index);
-                    }
                 }
+                merge_frontier(alg_frontier, local);
             }
 
-            current_adv.clear();
-
-            for (uint64_t alg_vertex_index : current_alg) {
-                if (alg_vertices_processed.contains(alg_vertex_index)) {
-                    continue;
-                }
-                alg_vertices_processed.insert(alg_vertex_index);
-                // Here we add all edges going out.
-                auto [wf_index, perm_index, req] = decode_alg(alg_vertex_index);
-                // fprintf(stderr, "alg%lu: alg potential %hd.\n", alg_vertex_index, alg_vertices[alg_vertex_index]);
-                // print_alg(alg_vertex_index);
-                // wf.reachable_wfs[wf_index].print();
-
-
-                // Instead of any permutation, we filter those which have higher than minimum value of WFA.
-                unsigned int wfa_minimum_value = wfa_minimum_values[encode_adv(wf_index, perm_index)];
-                for (int p = 0; p < factorial[SIZE]; p++) {
-                    unsigned int wfa_cost_for_this_index = wfa_cost(wf_index, perm_index, p);
-                    if (wfa_cost_for_this_index != wfa_minimum_value) {
-                        continue;
-                    }
-                    uint64_t target_adv = encode_adv(wf_index, p);
-                    if (!adv_vertices_processed.contains(target_adv)) {
-                        // fprintf(stderr, "alg%lu: WFA class suggests moving between alg%lu and adv%lu.\n", alg_vertex_index, alg_vertex_index, target_adv);
-                        current_adv.insert(target_adv);
+            adv_frontier.clear();
+#pragma omp parallel
+            {
+                std::vector<uint64_t> local{};
+#pragma omp for schedule(dynamic, 64) nowait
+                for (uint64_t i = 0; i < alg_frontier.size(); i++) {
+                    auto [wf_index, perm_index, req] = decode_alg(alg_frontier[i]);
+                    // Instead of any permutation, we filter those which have higher than minimum value of WFA.
+                    unsigned int wfa_minimum_value = wfa_minimum_values[encode_adv(wf_index, perm_index)];
+                    for (int p = 0; p < factorial[SIZE]; p++) {
+                        if (wfa_cost(wf_index, perm_index, p) != wfa_minimum_value) {
+                            continue;
+                        }
+                        uint64_t target_adv = encode_adv(wf_index, p);
+                        if (adv_visited.insert_atomic(target_adv)) {
+                            local.push_back(target_adv);
+                        }
                     }
                 }
+                merge_frontier(adv_frontier, local);
             }
-
-            current_alg.clear();
         }
 
-        reinitialize_reachable_arrays(adv_vertices_processed, alg_vertices_processed);
-        fprintf(stderr, "Reachable via the last three maximizer moves: %zu adv vertices, %zu alg vertices.\n",
-                adv_vertices_processed.size(), alg_vertices_processed.size());
+        adv_visited.build_ranks();
+        alg_visited.build_ranks();
     }
-    void serialize_reachable_arrays(const std::string& reachable_arrays_filename) const {
 
-        FILE* binary_file = fopen(reachable_arrays_filename.c_str(), "wb");
-        size_t written = 0;
-        written = fwrite(&reachable_advsize, sizeof(uint64_t), 1, binary_file);
-        if (written != 1) {
-            PRINT_AND_ABORT("Reachable_advsize was not written correctly.\n");
-        }
-        written = fwrite(adv_vertices_reachable, sizeof(uint64_t), reachable_advsize, binary_file);
-        if (written != reachable_advsize) {
-            PRINT_AND_ABORT("The reachable ADV array was not written correctly.\n");
-        }
+    // The decisions of a reachable ADV vertex; the rank of the vertex is its position in opt_decisions.
+    request_set& opt_decision(uint64_t adv_index) {
+        assert(adv_reachable.contains(adv_index));
+        return opt_decisions[adv_reachable.rank(adv_index)];
+    }
 
-        written = fwrite(&reachable_algsize, sizeof(uint64_t), 1, binary_file);
-        if (written != 1) {
-            PRINT_AND_ABORT("Reachable_algsize was not written correctly.\n");
-        }
-        written = fwrite(alg_vertices_reachable, sizeof(uint64_t), reachable_algsize, binary_file);
-        if (written != reachable_algsize) {
-            PRINT_AND_ABORT("The reachable ALG array was not written correctly.\n");
+    // The requests ADV may make according to the current OPT decisions. A vertex outside
+    // the reachable subgraph counts as the decision {0}, as it did when the decisions were kept in a map.
+    bool opt_decision_allows(uint64_t adv_index, int8_t r) const {
+        assert(opt_decisions.size() == reachable_advsize);
+        if (!adv_reachable.contains(adv_index)) {
+            return r == 0;
         }
+        return request_set_contains(opt_decisions[adv_reachable.rank(adv_index)], r);
+    }
 
-        fclose(binary_file);
+    // Compute how many ALG and ADV vertices are reachable via just the last three maximizer moves.
+    // When following the OPT decisions, the decisions are carried over to the new reachable vertices.
+    void wfa_reachable_via(bool last_three = false) {
+        rank_bitmap new_adv_reachable{}, new_alg_reachable{};
+        reachable_traversal(new_adv_reachable, new_alg_reachable,
+                            [&](uint64_t adv_index, uint64_t, uint64_t, int8_t r) {
+            if (last_three) {
+                // Skip any choice that is not the last three.
+                return request_set_contains(last_three_maximizers[adv_index], r);
+            }
+            // Use the opt decisions for testing if we should skip.
+            return opt_decision_allows(adv_index, r);
+        });
+
+        std::vector<request_set> new_decisions{};
+        if (!last_three) {
+            new_decisions.reserve(new_adv_reachable.count());
+            new_adv_reachable.for_each([&](uint64_t index) {
+                new_decisions.push_back(adv_reachable.contains(index) ? opt_decisions[adv_reachable.rank(index)] : 1);
+            });
+        }
+
+        // The decision subgraph is kept, so that update_decision_subgraph() can reuse it.
+        decision_subgraph kept_decision_graph = std::move(decision_graph);
+        free_reachable_arrays();
+        decision_graph = std::move(kept_decision_graph);
+        adv_reachable = std::move(new_adv_reachable);
+        alg_reachable = std::move(new_alg_reachable);
+        finish_reachable_arrays();
+        if (!last_three) {
+            opt_decisions = std::move(new_decisions);
+        }
+        fprintf(stderr, "Reachable via the last three maximizer moves: %" PRIu64 " adv vertices, %" PRIu64
+                " alg vertices.\n", reachable_advsize, reachable_algsize);
+    }
 
-        fprintf(stderr, "Reachable array save: adv %" PRIu64 ", alg %" PRIu64 ". Check: %" PRIu64 ", %" PRIu64 ", %" PRIu64 ".\n",
-            reachable_advsize, reachable_algsize, adv_vertices_reachable[0], adv_vertices_reachable[1], adv_vertices_reachable[2]);
+    // ADV may take any edge which is tight or better for the current potentials;
+    // we are maximizing, so any value equal or larger could affect the potential.
+    bool tight_or_better_adv_edge(uint64_t adv_index, uint64_t wf_index, uint64_t perm_index, int8_t r) const {
+        uint64_t alg_index = adv_move(wf_index, perm_index, r);
+        return alg_potential(alg_index) - adv_cost(wf_index, r) >= adv_vertices[adv_index];
+    }
+
+    // Sections: the ADV and ALG bitmaps, followed by their rank directories.
+    void serialize_reachable_arrays(const std::string& reachable_arrays_filename) const {
+        sectioned_file_writer writer(reachable_arrays_filename,
+                                     {adv_reachable.words * sizeof(uint64_t), alg_reachable.words * sizeof(uint64_t),
+                                      (adv_reachable.blocks + 1) * sizeof(uint64_t),
+                                      (alg_reachable.blocks + 1) * sizeof(uint64_t)});
+        writer.write(0, adv_reachable.data, adv_reachable.words * sizeof(uint64_t));
+        writer.write(1, alg_reachable.data, alg_reachable.words * sizeof(uint64_t));
+        writer.write(2, adv_reachable.block_ranks, (adv_reachable.blocks + 1) * sizeof(uint64_t));
+        writer.write(3, alg_reachable.block_ranks, (alg_reachable.blocks + 1) * sizeof(uint64_t));
+        writer.close();
+
+        fprintf(stderr, "Reachable array save: adv %" PRIu64 ", alg %" PRIu64 ".\n",
+            reachable_advsize, reachable_algsize);
     }
 
     void deserialize_reachable_arrays(const std::string& reachable_arrays_filename) {
+        free_reachable_arrays();
+        if (mapped_file::is_sectioned(reachable_arrays_filename)) {
+            // The reachable arrays are only read, so the mapping is shared.
+            reachable_mapping = new mapped_file(reachable_arrays_filename, false);
+            if (reachable_mapping->sections() == 4) {
+                if (reachable_mapping->elements<uint64_t>(0) != rank_bitmap::words_for(advsize) ||
+                    reachable_mapping->elements<uint64_t>(1) != rank_bitmap::words_for(algsize)) {
+                    PRINT_AND_ABORT("The reachable arrays in %s do not match the game graph.\n",
+                                    reachable_arrays_filename.c_str());
+                }
+                adv_reachable.attach(advsize, reachable_mapping->section<uint64_t>(0),
+                                     reachable_mapping->section<uint64_t>(2));
+                alg_reachable.attach(algsize, reachable_mapping->section<uint64_t>(1),
+                                     reachable_mapping->section<uint64_t>(3));
+                reachable_advsize = adv_reachable.count();
+                reachable_algsize = alg_reachable.count();
+                default_opt_decisions();
+                fprintf(stderr, "Reachable array map: adv %" PRIu64 ", alg %" PRIu64 ".\n",
+                        reachable_advsize, reachable_algsize);
+                return;
+            }
+
+            // An index list from before the bitmaps.
+            reachable_from_indices(adv_reachable, advsize, reachable_mapping->section<uint64_t>(0),
+                                   reachable_mapping->elements<uint64_t>(0));
+            reachable_from_indices(alg_reachable, algsize, reachable_mapping->section<uint64_t>(1),
+                                   reachable_mapping->elements<uint64_t>(1));
+            delete reachable_mapping;
+            reachable_mapping = nullptr;
+            finish_reachable_arrays();
+            fprintf(stderr, "Reachable array load: adv %" PRIu64 ", alg %" PRIu64 ".\n",
+                    reachable_advsize, reachable_algsize);
+            return;
+        }
 
         FILE* binary_file = fopen(reachable_arrays_filename.c_str(), "rb");
         size_t read = 0;
-        read = fread(&reachable_advsize, sizeof(uint64_t), 1, binary_file);
+        uint64_t count = 0;
+        read = fread(&count, sizeof(uint64_t), 1, binary_file);
         if (read != 1) {
             PRINT_AND_ABORT("Reachable ADV size was not read correctly.");
         }
 
-        adv_vertices_reachable = new uint64_t[reachable_advsize];
-        read = fread(adv_vertices_reachable, sizeof(uint64_t), reachable_advsize, binary_file);
-        if (read != reachable_advsize) {
+        std::vector<uint64_t> indices(count);
+        read = fread(indices.data(), sizeof(uint64_t), count, binary_file);
+        if (read != count) {
             PRINT_AND_ABORT("The reachable ADV array was not written correctly.\n");
         }
+        reachable_from_indices(adv_reachable, advsize, indices.data(), count);
 
-        read = fread(&reachable_algsize, sizeof(uint64_t), 1, binary_file);
+        read = fread(&count, sizeof(uint64_t), 1, binary_file);
         if (read != 1) {
             PRINT_AND_ABORT("Reachable ALG size was not read correctly.");
         }
 
-        alg_vertices_reachable = new uint64_t[reachable_algsize];
-        read = fread(alg_vertices_reachable, sizeof(uint64_t), reachable_algsize, binary_file);
-        if (read != reachable_algsize) {
+        indices.resize(count);
+        read = fread(indices.data(), sizeof(uint64_t), count, binary_file);
+        if (read != count) {
             PRINT_AND_ABORT("The reachable ALG array was not written correctly.\n");
         }
+        reachable_from_indices(alg_reachable, algsize, indices.data(), count);
 
         fclose(binary_file);
+        finish_reachable_arrays();
 
-        fprintf(stderr, "Reachable array load: adv %" PRIu64 ", alg %" PRIu64 ". Check: %" PRIu64 ", %" PRIu64 ", %" PRIu64 ".\n",
-    reachable_advsize, reachable_algsize, adv_vertices_reachable[0], adv_vertices_reachable[1], adv_vertices_reachable[2]);
+        fprintf(stderr, "Reachable array load: adv %" PRIu64 ", alg %" PRIu64 ".\n",
+    reachable_advsize, reachable_algsize);
     }
 
 
-    // Converts the set of three choices of all reachable vertices into a decision map.
+    // Converts the set of three choices of all reachable vertices into the decisions.
     void build_decision_map() {
-        for (uint64_t reachable_index = 0; reachable_index < reachable_advsize; reachable_index++) {
-            uint64_t index = adv_vertices_reachable[reachable_index];
-            opt_decision_map.insert({index, last_three_maximizers[index]});
-        }
-    }
-
-    void update_decision_map() {
-        auto opt_decision_map_copy = opt_decision_map;
-        opt_decision_map.clear();
-        for (uint64_t reachable_index = 0; reachable_index < reachable_advsize; reachable_index++) {
-            uint64_t index = adv_vertices_reachable[reachable_index];
-            opt_decision_map.insert({index, opt_decision_map_copy[index]});
-        }
+        opt_decisions.clear();
+        opt_decisions.reserve(reachable_advsize);
+        adv_reachable.for_each([&](uint64_t index) {
+            opt_decisions.push_back(last_three_maximizers[index]);
+        });
     }
 
     std::pair<bool, uint64_t> find_first_decision() {
-        for (uint64_t reachable_index = 0; reachable_index < reachable_advsize; reachable_index++) {
-            uint64_t index = adv_vertices_reachable[reachable_index];
-            int minus_ones = 0;
-            for (int i = 0; i < 3; i++) {
-                if (opt_decision_map[index][i] == -1) {
-                    minus_ones++;
+        uint64_t reachable_index = 0;
+        for (uint64_t word = 0; word < adv_reachable.words; word++) {
+            uint64_t bits = adv_reachable.data[word];
+            while (bits != 0) {
+                uint64_t index = word * 64 + std::countr_zero(bits);
+                bits &= bits - 1;
+                const int choices = std::popcount(opt_decisions[reachable_index++]);
+                assert(choices > 0);
+                if (choices >= 2) {
+                    return {true, index};
                 }
             }
-            assert(minus_ones < 3);
-            if (minus_ones <= 1) {
-                return {true, index};
-            }
         }
         return {false, 0};
     }
@@ -1230,152 +2110,281 @@ public:
         opt_wins_via_decisions();
     }
 
-    void lowerbound_via_decisions() {
-        assert(reachable_algsize > 0 && reachable_algsize > 0);
-        build_decision_map();
-        int number_of_decisions = 0;
-        bool decision_exists = true;
-        while (true) {
-            auto [decision_exists, index_to_decide] = find_first_decision();
-            if (!decision_exists) {
-                break;
-            }
-            number_of_decisions++;
-            auto old_decision_array = opt_decision_map[index_to_decide];
-            fprintf(stderr, "Old decision array: %" PRIi8 " %" PRIi8 " %" PRIi8 ".\n",
-                old_decision_array[0], old_decision_array[1], old_decision_array[2]);
-            bool opt_wins = false;
-            for (int i = 0; i < 3; i++) {
-                // Make the decision.
-                if (old_decision_array[i] != -1) {
-                    fprintf(stderr, "Trying the decision of sending %" PRIi8 "at %" PRIu64 "\n",
-                        old_decision_array[i],index_to_decide);
-                    for (int j = 0; j < 3; j++) {
-                        if (j == i) {
-                            opt_decision_map[index_to_decide][j] = old_decision_array[j];
-                        } else {
-                            opt_decision_map[index_to_decide][j] = -1;
-                        }
-                    }
-                    fprintf(stderr, "New decision array: %" PRIi8 " %" PRIi8 " %" PRIi8 ".\n",
-    opt_decision_map[index_to_decide][0], opt_decision_map[index_to_decide][1], opt_decision_map[index_to_decide][2]);
-                    opt_wins = opt_wins_via_decisions();
-                    if (opt_wins) {
-                        fprintf(stderr, "OPT wins if we make the decision of sending %" PRIi8 " at %" PRIu64".\n",
-                            opt_decision_map[index_to_decide][i], index_to_decide);
-                        break;
-                    } else {
-                        fprintf(stderr, "ALG wins if we make the decision of sending %" PRIi8 " at %" PRIu64".\n",
-                            opt_decision_map[index_to_decide][i], index_to_decide);
-                    }
+    void build_decision_subgraph() {
+        if (reachable_advsize >= decision_subgraph::NO_VERTEX || reachable_algsize >= decision_subgraph::NO_VERTEX) {
+            PRINT_AND_ABORT("The reachable subgraph with %" PRIu64 " ADV and %" PRIu64 " ALG vertices is too large "
+                            "for the 32-bit ranks of the decision subgraph.\n", reachable_advsize, reachable_algsize);
+        }
+        decision_subgraph& dg = decision_graph;
+        dg = decision_subgraph{};
+        dg.adv_index.reserve(reachable_advsize);
+        adv_reachable.for_each([&](uint64_t index) {
+            dg.adv_index.push_back(index);
+        });
+        dg.adv_allowed.assign(reachable_advsize, 0);
+        dg.adv_moves.assign(reachable_advsize * SIZE, decision_subgraph::NO_VERTEX);
+        dg.adv_costs.assign(reachable_advsize * SIZE, 0);
+#pragma omp parallel for
+        for (uint64_t a = 0; a < reachable_advsize; a++) {
+            auto [wf_index, perm_index] = decode_adv(dg.adv_index[a]);
+            for (int8_t r = 0; r < SIZE; r++) {
+                uint64_t alg_index = adv_move(wf_index, perm_index, r);
+                if (!alg_reachable.contains(alg_index)) {
+                    continue;
                 }
+                dg.adv_moves[a * SIZE + r] = alg_reachable.rank(alg_index);
+                dg.adv_costs[a * SIZE + r] = adv_cost(wf_index, r);
+                dg.adv_allowed[a] |= opt_decisions[a] & (1 << r);
             }
-            assert(opt_wins);
-            wfa_reachable_via();
-            update_decision_map();
         }
 
-        // Finally, print the resulting array.
-        print_opt_decision_map();
-        fprintf(stderr, "Made %d decisions.\n", number_of_decisions);
-    }
-
-
-    // Print a lower bound (a graph winning for ADV) via propagation layer by layer. This may take a lot of
-    // time, but it is fairly gentle on memory.
-    void wfa_lowerbound_potential_propagation() {
-        std::unordered_set<uint64_t> adv_vertices_processed{};
-        std::unordered_set<uint64_t> alg_vertices_processed{};
-
-        std::unordered_set<uint64_t> current_adv{};
-        std::unordered_set<uint64_t> current_alg{};
-
-        // std::unordered_set<uint64_t> next_adv{};
-        // std::unordered_set<uint64_t> next_alg{};
-
-        current_adv.insert(0);
-        // print_adv(0);
-        while (!current_adv.empty()) {
-            for (uint64_t adv_vertex_index : current_adv) {
-                if (adv_vertices_processed.contains(adv_vertex_index)) {
+        // Every move into a minimum of WFA is reachable, as the reachability search takes all of them.
+        std::vector<uint64_t> alg_index;
+        alg_index.reserve(reachable_algsize);
+        alg_reachable.for_each([&](uint64_t index) {
+            alg_index.push_back(index);
+        });
+        dg.alg_offsets.assign(reachable_algsize + 1, 0);
+#pragma omp parallel for
+        for (uint64_t b = 0; b < reachable_algsize; b++) {
+            auto [wf_index, perm_index, req] = decode_alg(alg_index[b]);
+            unsigned int wfa_minimum_value = wfa_minimum_values[encode_adv(wf_index, perm_index)];
+            for (int p = 0; p < factorial[SIZE]; p++) {
+                dg.alg_offsets[b + 1] += wfa_cost(wf_index, perm_index, p) == wfa_minimum_value;
+            }
+        }
+        for (uint64_t b = 0; b < reachable_algsize; b++) {
+            dg.alg_offsets[b + 1] += dg.alg_offsets[b];
+        }
+        dg.alg_targets.resize(dg.alg_offsets[reachable_algsize]);
+        dg.alg_costs.resize(dg.alg_offsets[reachable_algsize]);
+#pragma omp parallel for
+        for (uint64_t b = 0; b < reachable_algsize; b++) {
+            auto [wf_index, perm_index, req] = decode_alg(alg_index[b]);
+            unsigned int wfa_minimum_value = wfa_minimum_values[encode_adv(wf_index, perm_index)];
+            uint64_t e = dg.alg_offsets[b];
+            for (int p = 0; p < factorial[SIZE]; p++) {
+                if (wfa_cost(wf_index, perm_index, p) != wfa_minimum_value) {
                     continue;
                 }
-                adv_vertices_processed.insert(adv_vertex_index);
-
-                auto [wf_index, perm_index] = decode_adv(adv_vertex_index);
-
-                // fprintf(stderr, "adv%lu: adv potential %hd.\n", adv_vertex_index, adv_vertices[adv_vertex_index]);
-                // print_adv(adv_vertex_index);
+                dg.alg_targets[e] = adv_reachable.rank(encode_adv(wf_index, p));
+                dg.alg_costs[e] = alg_cost(perm_index, p, req);
+                e++;
+            }
+        }
 
+        std::vector<std::pair<uint32_t, uint32_t>> edges;
+        for (uint32_t b = 0; b < reachable_algsize; b++) {
+            for (uint64_t e = dg.alg_offsets[b]; e < dg.alg_offsets[b + 1]; e++) {
+                edges.emplace_back(b, dg.alg_targets[e]);
+            }
+        }
+        decision_subgraph::reverse(reachable_advsize, edges, dg.adv_predecessor_offsets, dg.adv_predecessors);
+        edges.clear();
+        for (uint32_t a = 0; a < reachable_advsize; a++) {
+            for (int r = 0; r < SIZE; r++) {
+                if (dg.adv_moves[a * SIZE + r] != decision_subgraph::NO_VERTEX) {
+                    edges.emplace_back(a, dg.adv_moves[a * SIZE + r]);
+                }
+            }
+        }
+        decision_subgraph::reverse(reachable_algsize, edges, dg.alg_predecessor_offsets, dg.alg_predecessors);
+    }
 
-                // wf.reachable_wfs[wf_index].print();
+    // Making a decision only removes edges, so the new reachable subgraph is a subset of the one
+    // decision_graph was built for. If it has as many vertices, it is the same one, and only the requests
+    // allowed by the OPT decisions change; otherwise the subgraph is built again.
+    void update_decision_subgraph() {
+        decision_subgraph& dg = decision_graph;
+        if (dg.adv_index.size() != reachable_advsize || dg.alg_offsets.size() != reachable_algsize + 1) {
+            build_decision_subgraph();
+            return;
+        }
+#pragma omp parallel for
+        for (uint64_t a = 0; a < reachable_advsize; a++) {
+            dg.adv_allowed[a] = 0;
+            for (int8_t r = 0; r < SIZE; r++) {
+                if (dg.adv_moves[a * SIZE + r] != decision_subgraph::NO_VERTEX) {
+                    dg.adv_allowed[a] |= opt_decisions[a] & (1 << r);
+                }
+            }
+        }
+    }
 
-                // Compute the would-be new potential.
-                /* short current_pot = adv_vertices[adv_vertex_index];
+    // The same fixpoint as opt_wins_via_decisions(), with the decision at decided_index replaced by
+    // the single request decided_request, on potentials of its own. Every vertex the fixpoint reads is reachable,
+    // and all of them start from zero, so the potentials are arrays over the reachable vertices,
+    // indexed by their rank, and several branches can run at once. Returns false early once cancelled() holds.
+    //
+    // The rounds are those of opt_wins_via_decisions(), but after the first one, only the vertices
+    // whose successors changed are evaluated again, through the reverse edges of decision_graph.
+    // The previous fixpoint is of no use as a starting point: restricting OPT lowers the least fixpoint,
+    // and iterating from above it may stop at a higher one.
+    template <typename CANCELLED> bool opt_wins_with_decision(uint64_t decided_index, int8_t decided_request,
+                                                              CANCELLED cancelled) const {
+        const decision_subgraph& dg = decision_graph;
+        assert(dg.adv_index.size() == reachable_advsize);
+        const uint64_t decided_rank = adv_reachable.rank(decided_index);
+        std::vector<short> adv_pots(reachable_advsize, 0);
+        std::vector<short> alg_pots(reachable_algsize, 0);
+        // The number of ADV potentials which are not positive yet; OPT wins once there are none.
+        uint64_t nonpositive = reachable_advsize;
+
+        std::vector<uint32_t> adv_work(reachable_advsize);
+        std::vector<uint32_t> alg_work(reachable_algsize);
+        std::iota(adv_work.begin(), adv_work.end(), 0);
+        std::iota(alg_work.begin(), alg_work.end(), 0);
+        std::vector<uint8_t> adv_queued(reachable_advsize, 1);
+        std::vector<uint8_t> alg_queued(reachable_algsize, 1);
+        std::vector<uint32_t> next_work{};
+
+        while (!adv_work.empty() || !alg_work.empty()) {
+            if (cancelled()) {
+                return false;
+            }
+            for (uint32_t a : adv_work) {
+                adv_queued[a] = 0;
+                const uint8_t allowed = a == decided_rank ? 1 << decided_request : dg.adv_allowed[a];
                 short new_pot = std::numeric_limits<short>::min();
-                int maximizer_request = -1;
                 for (int r = 0; r < SIZE; r++) {
-                    uint64_t new_wf_index = wf.adjacency(wf_index, r);
-                    uint64_t alg_index = encode_alg(new_wf_index, perm_index, r);
-                    short adv_cost_s = adv_cost(wf_index, r);
-                    if (alg_vertices[alg_index] - adv_cost_s > new_pot) {
-                        new_pot = alg_vertices[alg_index] - adv_cost_s;
-                        maximizer_request = r;
+                    if (allowed & (1 << r)) {
+                        new_pot = std::max<short>(new_pot, alg_pots[dg.adv_moves[a * SIZE + r]] - dg.adv_costs[a * SIZE + r]);
                     }
                 }
-                */
-
-                short current_pot = adv_vertices[adv_vertex_index];
-
-                for (int r = 0; r < SIZE; r++) {
-                    uint64_t new_wf_index = wf.adjacency(wf_index, r);
-                    uint64_t alg_index = encode_alg(new_wf_index, perm_index, r);
-                    short adv_cost_s = adv_cost(wf_index, r);
-                    // We are maximizing, so any value equal or larger could affect the potential.
-                    if (alg_vertices[alg_index] - adv_cost_s >= current_pot) {
-                        // fprintf(stderr, "Candidate edge between adv%lu and alg%lu, with new potential" " %hd and current potential %d.\n", adv_vertex_index, alg_index, alg_vertices[alg_index] - adv_cost_s, current_pot);
-                        // fprintf(stderr, "adv%lu with req %hd: updated work function number %lu. Next alg%lu.\n", adv_vertex_index, maximizer_request, new_wf_index, alg_index);
-                        if (!alg_vertices_processed.contains(alg_index)) {
-                            current_alg.insert(alg_index);
-                        }
+                if (adv_pots[a] == new_pot) {
+                    continue;
+                }
+                nonpositive += (uint64_t) (new_pot <= 0) - (uint64_t) (adv_pots[a] <= 0);
+                adv_pots[a] = new_pot;
+                for (uint64_t e = dg.adv_predecessor_offsets[a]; e < dg.adv_predecessor_offsets[a + 1]; e++) {
+                    uint32_t b = dg.adv_predecessors[e];
+                    if (!alg_queued[b]) {
+                        alg_queued[b] = 1;
+                        alg_work.push_back(b);
                     }
                 }
             }
+            if (nonpositive == 0) {
+                return true;
+            }
 
-            current_adv.clear();
-
-            for (uint64_t alg_vertex_index : current_alg) {
-                if (alg_vertices_processed.contains(alg_vertex_index)) {
+            next_work.clear();
+            for (uint32_t b : alg_work) {
+                alg_queued[b] = 0;
+                short new_pot = std::numeric_limits<short>::max();
+                for (uint64_t e = dg.alg_offsets[b]; e < dg.alg_offsets[b + 1]; e++) {
+                    new_pot = std::min<short>(new_pot, adv_pots[dg.alg_targets[e]] + dg.alg_costs[e]);
+                }
+                if (alg_pots[b] == new_pot) {
                     continue;
                 }
-                alg_vertices_processed.insert(alg_vertex_index);
-                // Here we add all edges going out.
-                auto [wf_index, perm_index, req] = decode_alg(alg_vertex_index);
-                // fprintf(stderr, "alg%lu: alg potential %hd.\n", alg_vertex_index, alg_vertices[alg_vertex_index]);
-                // print_alg(alg_vertex_index);
-                // wf.reachable_wfs[wf_index].print();
-
-
-                // Instead of any permutation, we filter those which have higher than minimum value of WFA.
-                unsigned int wfa_minimum_value = wfa_minimum_values[encode_adv(wf_index, perm_index)];
-                for (int p = 0; p < factorial[SIZE]; p++) {
-                    unsigned int wfa_cost_for_this_index = wfa_cost(wf_index, perm_index, p);
-                    if (wfa_cost_for_this_index != wfa_minimum_value) {
-                        continue;
-                    }
-                    uint64_t target_adv = encode_adv(wf_index, p);
-                    if (!adv_vertices_processed.contains(target_adv)) {
-                        // fprintf(stderr, "alg%lu: WFA class suggests moving between alg%lu and adv%lu.\n", alg_vertex_index, alg_vertex_index, target_adv);
-                        current_adv.insert(target_adv);
+                alg_pots[b] = new_pot;
+                for (uint64_t e = dg.alg_predecessor_offsets[b]; e < dg.alg_predecessor_offsets[b + 1]; e++) {
+                    uint32_t a = dg.alg_predecessors[e];
+                    if (!adv_queued[a]) {
+                        adv_queued[a] = 1;
+                        next_work.push_back(a);
                     }
                 }
             }
+            alg_work.clear();
+            std::swap(adv_work, next_work);
+        }
+        return false;
+    }
 
-            current_alg.clear();
+    // Runs branch(i, cancelled) for the choices 0, ..., choice_count - 1 at once, on up to three threads, and
+    // returns the first i for which it returns true, or choice_count if there is none. A branch should return
+    // early once cancelled() holds, which happens once an earlier one is known to win; the result is the same
+    // as when trying the choices one by one.
+    template <typename BRANCH> static int first_winner_among(int choice_count, BRANCH branch) {
+        std::atomic<int> first_winner{choice_count};
+#pragma omp parallel for schedule(dynamic, 1) num_threads(3)
+        for (int i = 0; i < choice_count; i++) {
+            auto cancelled = [&] {
+                return first_winner.load(std::memory_order_relaxed) < i;
+            };
+            if (branch(i, cancelled)) {
+                int winner = first_winner.load();
+                while (i < winner && !first_winner.compare_exchange_weak(winner, i)) {}
+            }
         }
+        return first_winner.load();
+    }
 
-        fprintf(stderr, "Propagation visited %zu vertices.\n",
-                adv_vertices_processed.size() + alg_vertices_processed.size());
+    // Tries the up to three choices of OPT at the ADV vertex at once, one branch per choice, on decision_graph.
+    // The first choice (the smallest request) for which OPT wins is taken. Returns the position of that choice
+    // among the choices, or their number if ALG wins with all of them.
+    int first_winning_choice(uint64_t index_to_decide, const std::vector<int8_t>& choices) const {
+        return first_winner_among(choices.size(), [&](int i, auto cancelled) {
+            fprintf(stderr, "Trying the decision of sending %" PRIi8 " at %" PRIu64 ".\n",
+                choices[i], index_to_decide);
+            bool opt_wins = opt_wins_with_decision(index_to_decide, choices[i], cancelled);
+            if (opt_wins) {
+                fprintf(stderr, "OPT wins if we make the decision of sending %" PRIi8 " at %" PRIu64".\n",
+                    choices[i], index_to_decide);
+            } else if (!cancelled()) {
+                fprintf(stderr, "ALG wins if we make the decision of sending %" PRIi8 " at %" PRIu64".\n",
+                    choices[i], index_to_decide);
+            }
+            return opt_wins;
+        });
+    }
+
+    // Makes the decisions one by one with first_winning_choice(). OPT wins with the decisions made so far,
+    // so one of the choices must let it win; if none does, the search aborts.
+    // Returns the number of decisions made.
+    int lowerbound_via_decisions() {
+        assert(reachable_algsize > 0 && reachable_algsize > 0);
+        build_decision_map();
+        build_decision_subgraph();
+        int number_of_decisions = 0;
+        while (true) {
+            auto [decision_exists, index_to_decide] = find_first_decision();
+            if (!decision_exists) {
+                break;
+            }
+            number_of_decisions++;
+            const request_set old_decision = opt_decision(index_to_decide);
+            fprintf(stderr, "Old decision set: ");
+            print_request_set(old_decision);
+            fprintf(stderr, ".\n");
+
+            std::vector<int8_t> choices{};
+            for (int8_t r = 0; r < SIZE; r++) {
+                if (request_set_contains(old_decision, r)) {
+                    choices.push_back(r);
+                }
+            }
+            const int winner = first_winning_choice(index_to_decide, choices);
+            if (winner == (int) choices.size()) {
+                PRINT_AND_ABORT("ALG wins with every choice of OPT at %" PRIu64 ".\n", index_to_decide);
+            }
+            opt_decision(index_to_decide) = 1 << choices[winner];
+            fprintf(stderr, "New decision set: ");
+            print_request_set(opt_decision(index_to_decide));
+            fprintf(stderr, ".\n");
+            wfa_reachable_via();
+            update_decision_subgraph();
+        }
+
+        // Finally, print the resulting array.
+        print_opt_decision_map();
+        fprintf(stderr, "Made %d decisions.\n", number_of_decisions);
+        return number_of_decisions;
+    }
+
+
+    // Print a lower bound (a graph winning for ADV) via propagation layer by layer. This may take a lot of
+    // time, but it is fairly gentle on memory.
+    void wfa_lowerbound_potential_propagation() {
+        rank_bitmap adv_visited{}, alg_visited{};
+        reachable_traversal(adv_visited, alg_visited, [&](uint64_t adv_index, uint64_t wf_index,
+                                                          uint64_t perm_index, int8_t r) {
+            return tight_or_better_adv_edge(adv_index, wf_index, perm_index, r);
+        });
+
+        fprintf(stderr, "Propagation visited %" PRIu64 " vertices.\n", adv_visited.count() + alg_visited.count());
     }
 
     // Converts the full structure into a simple digraph object that is easier to work with.
@@ -1396,8 +2405,7 @@ public:
             }
 
             for (int r = 0; r < SIZE; r++) {
-                uint64_t new_wf_index = wf.adjacency(wf_index, r);
-                uint64_t alg_index = encode_alg(new_wf_index, perm_index, r);
+                uint64_t alg_index = adv_move(wf_index, perm_index, r);
                 short adv_cost_s = adv_cost(wf_index, r);
 
                 unsigned long int target_digraph_id = -1;
@@ -1448,114 +2456,49 @@ public:
         return ret;
     }
 
+    // The vertices are found by reachable_traversal(). In the digraph, the ADV vertices come first,
+    // numbered by their rank among the visited ones, followed by the ALG vertices.
     digraph* wfa_propagation_build_digraph() {
         auto *ret = new digraph();
+        rank_bitmap adv_visited{}, alg_visited{};
+        reachable_traversal(adv_visited, alg_visited, [&](uint64_t adv_index, uint64_t wf_index,
+                                                          uint64_t perm_index, int8_t r) {
+            return tight_or_better_adv_edge(adv_index, wf_index, perm_index, r);
+        });
 
-        std::unordered_set<uint64_t> adv_vertices_processed{};
-        std::unordered_set<uint64_t> alg_vertices_processed{};
-
-        std::unordered_set<uint64_t> current_adv{};
-        std::unordered_set<uint64_t> current_alg{};
-
-        // std::unordered_set<uint64_t> next_adv{};
-        // std::unordered_set<uint64_t> next_alg{};
-
-        std::unordered_map<uint64_t, unsigned long int> adv_vertex_to_digraph_vertex;
-        std::unordered_map<uint64_t, unsigned long int> alg_vertex_to_digraph_vertex;
-
-        current_adv.insert(0);
-        unsigned long int initial_vert = ret->add_vertex();
-        adv_vertex_to_digraph_vertex[0] = initial_vert;
+        const uint64_t adv_count = adv_visited.count();
+        for (uint64_t v = 0; v < adv_count + alg_visited.count(); v++) {
+            ret->add_vertex();
+        }
 
-        // print_adv(0);
-        while (!current_adv.empty()) {
-            for (uint64_t adv_vertex_index : current_adv) {
-                if (adv_vertices_processed.contains(adv_vertex_index)) {
+        adv_visited.for_each([&](uint64_t adv_vertex_index) {
+            auto [wf_index, perm_index] = decode_adv(adv_vertex_index);
+            for (int8_t r = 0; r < SIZE; r++) {
+                if (!tight_or_better_adv_edge(adv_vertex_index, wf_index, perm_index, r)) {
                     continue;
                 }
-                adv_vertices_processed.insert(adv_vertex_index);
-
-                assert(adv_vertex_to_digraph_vertex.contains(adv_vertex_index));
-
-                auto [wf_index, perm_index] = decode_adv(adv_vertex_index);
-
-                short current_pot = adv_vertices[adv_vertex_index];
-
-                for (int r = 0; r < SIZE; r++) {
-                    uint64_t new_wf_index = wf.adjacency(wf_index, r);
-                    uint64_t alg_index = encode_alg(new_wf_index, perm_index, r);
-                    short adv_cost_s = adv_cost(wf_index, r);
-                    // We are maximizing, so any value equal or larger could affect the potential.
-                    if (alg_vertices[alg_index] - adv_cost_s >= current_pot) {
-                        // fprintf(stderr, "Candidate edge between adv%lu and alg%lu, with new potential" " %hd and current potential %d.\n", adv_vertex_index, alg_index, alg_vertices[alg_index] - adv_cost_s, current_pot);
-                        // fprintf(stderr, "adv%lu with req %hd: updated work function number %lu. Next alg%lu.\n", adv_vertex_index, maximizer_request, new_wf_index, alg_index);
-
-                        unsigned long int target_digraph_id = -1;
-                        if (!alg_vertex_to_digraph_vertex.contains(alg_index)) {
-                            target_digraph_id = ret->add_vertex();
-                            alg_vertex_to_digraph_vertex[alg_index] = target_digraph_id;
-                        } else {
-                            target_digraph_id = alg_vertex_to_digraph_vertex[alg_index];
-                        }
-
-                        ret->add_edge(adv_vertex_to_digraph_vertex[adv_vertex_index], target_digraph_id, -1.0 * static_cast<double>(adv_cost_s));
-
-
-                        if (!alg_vertices_processed.contains(alg_index)) {
-                            current_alg.insert(alg_index);
-                        }
-                    }
-                }
+                uint64_t alg_index = adv_move(wf_index, perm_index, r);
+                short adv_cost_s = adv_cost(wf_index, r);
+                ret->add_edge(adv_visited.rank(adv_vertex_index), adv_count + alg_visited.rank(alg_index),
+                              -1.0 * static_cast<double>(adv_cost_s));
             }
+        });
 
-            current_adv.clear();
-
-            for (uint64_t alg_vertex_index : current_alg) {
-                if (alg_vertices_processed.contains(alg_vertex_index)) {
+        alg_visited.for_each([&](uint64_t alg_vertex_index) {
+            auto [wf_index, perm_index, req] = decode_alg(alg_vertex_index);
+            // Instead of any permutation, we filter those which have higher than minimum value of WFA.
+            unsigned int wfa_minimum_value = wfa_minimum_values[encode_adv(wf_index, perm_index)];
+            for (int p = 0; p < factorial[SIZE]; p++) {
+                if (wfa_cost(wf_index, perm_index, p) != wfa_minimum_value) {
                     continue;
                 }
-                alg_vertices_processed.insert(alg_vertex_index);
-
-                assert(alg_vertex_to_digraph_vertex.contains(alg_vertex_index));
-                // Here we add all edges going out.
-                auto [wf_index, perm_index, req] = decode_alg(alg_vertex_index);
-                // fprintf(stderr, "alg%lu: alg potential %hd.\n", alg_vertex_index, alg_vertices[alg_vertex_index]);
-                // print_alg(alg_vertex_index);
-                // wf.reachable_wfs[wf_index].print();
-
-
-                // Instead of any permutation, we filter those which have higher than minimum value of WFA.
-                unsigned int wfa_minimum_value = wfa_minimum_values[encode_adv(wf_index, perm_index)];
-                for (int p = 0; p < factorial[SIZE]; p++) {
-                    unsigned int wfa_cost_for_this_index = wfa_cost(wf_index, perm_index, p);
-                    if (wfa_cost_for_this_index != wfa_minimum_value) {
-                        continue;
-                    }
-                    uint64_t target_adv = encode_adv(wf_index, p);
-
-                    unsigned long int target_digraph_id = -1;
-                    if (!adv_vertex_to_digraph_vertex.contains(target_adv)) {
-                        target_digraph_id = ret->add_vertex();
-                        adv_vertex_to_digraph_vertex[target_adv] = target_digraph_id;
-                    } else {
-                        target_digraph_id = adv_vertex_to_digraph_vertex[target_adv];
-                    }
-
-                    short alg_cost_s = alg_cost(perm_index, p, req);
-                    ret->add_edge(alg_vertex_to_digraph_vertex[alg_vertex_index], target_digraph_id, alg_cost_s);
-
-                    if (!adv_vertices_processed.contains(target_adv)) {
-                        // fprintf(stderr, "alg%lu: WFA class suggests moving between alg%lu and adv%lu.\n", alg_vertex_index, alg_vertex_index, target_adv);
-                        current_adv.insert(target_adv);
-                    }
-                }
+                uint64_t target_adv = encode_adv(wf_index, p);
+                short alg_cost_s = alg_cost(perm_index, p, req);
+                ret->add_edge(adv_count + alg_visited.rank(alg_vertex_index), adv_visited.rank(target_adv), alg_cost_s);
             }
+        });
 
-            current_alg.clear();
-        }
-
-        fprintf(stderr, "Propagation visited %zu vertices.\n",
-                adv_vertices_processed.size() + alg_vertices_processed.size());
+        fprintf(stderr, "Propagation visited %" PRIu64 " vertices.\n", adv_count + alg_visited.count());
 
         return ret;
     }
@@ -1587,7 +2530,7 @@ public:
                 print_shortest_path(index, shortest_path);
                 for (short r = 0; r < SIZE; r++) {
                     unsigned long next_wf = wf.adjacency(wf_index, r);
-                    unsigned long next_alg_index = encode_alg(next_wf, perm_index, r);
+                    unsigned long next_alg_index = adv_move(wf_index, perm_index, r);
                     std::vector<short> next_shortest_path(shortest_path);
                     next_shortest_path.push_back(r);
                     fprintf(stderr, "adv%lu with req %hd: updated work function number %lu. Next alg%lu.\n",
@@ -1600,7 +2543,7 @@ public:
             } else {
                 auto [wf_index, perm_index, request] = decode_alg(index);
                 print_alg(index);
-                fprintf(stderr, "alg%lu: alg potential %hd.\n", index, alg_vertices[index]);
+                fprintf(stderr, "alg%lu: alg potential %hd.\n", index, alg_potential(index));
 
                 // Main difference: we only expand on tight edges here.
                 // Compute the number of tight edges first. It slows down the printing, but nothing important.
@@ -1608,18 +2551,18 @@ public:
                 for (unsigned long p = 0; p < factorial[SIZE]; p++) {
                     unsigned long next_adv_index = encode_adv(wf_index, p);
                     short alg_cost_s = alg_cost(perm_index, p, request);
-                    if (adv_vertices[next_adv_index] + alg_cost_s == alg_vertices[index]) {
+                    if (adv_vertices[next_adv_index] + alg_cost_s == alg_potential(index)) {
                         tight_size++;
                     }
                 }
 
                 unsigned long tight_index = 0;
-                permutation<LISTSIZE> current_alg_pos = wf.pm.all_perms[perm_index];
+                permutation<SIZE> current_alg_pos = wf.pm.all_perms[perm_index];
                 unsigned long wfa_minimum = workfunction_algorithm_minimum(wf_index, perm_index, request);
                 for (unsigned long p = 0; p < factorial[SIZE]; p++) {
                     unsigned long next_adv_index = encode_adv(wf_index, p);
                     short alg_cost_s = alg_cost(perm_index, p, request);
-                    if (adv_vertices[next_adv_index] + alg_cost_s == alg_vertices[index]) {
+                    if (adv_vertices[next_adv_index] + alg_cost_s == alg_potential(index)) {
                         fprintf(stderr, "Tight edge %lu/%lu between alg%lu and adv%lu.",
                                 tight_index, tight_size, index, next_adv_index);
                         unsigned long wfa_cost_for_this_move = wfa_cost(wf_index, &current_alg_pos, p);
@@ -1660,59 +2603,55 @@ public:
     }
 
     void print_top_three_for_reachable() const {
-        for (uint64_t reachable_index = 0; reachable_index < reachable_advsize; reachable_index++) {
-            uint64_t index = adv_vertices_reachable[reachable_index];
-            fprintf(stderr, "Reachable #%" PRIu64 ": vertex index %" PRIu64 ", ", reachable_index, index);
-
-            fprintf(stderr, "[");
-            bool first = true;
-            for (int j = 0; j < 3; j++) {
-                if (last_three_maximizers[index][j] != -1) {
-                    if (!first) {
-                        fprintf(stderr, ",");
-                    } else {
-                        first = false;
-                    }
-
-                    fprintf(stderr, "%" PRIi8 "", last_three_maximizers[index][j] );
-                }
+        for (uint64_t word = 0; word < adv_reachable.words; word++) {
+            uint64_t bits = adv_reachable.data[word];
+            while (bits != 0) {
+                uint64_t index = word * 64 + std::countr_zero(bits);
+                bits &= bits - 1;
+                uint64_t reachable_index = adv_reachable.rank(index);
+                fprintf(stderr, "Reachable #%" PRIu64 ": vertex index %" PRIu64 ", ", reachable_index, index);
+
+                print_request_set(last_three_maximizers[index]);
+                fprintf(stderr, "\n");
             }
-            fprintf(stderr, "]\n");
         }
     }
 
     void print_opt_decision_map() {
-        for (uint64_t reachable_index = 0; reachable_index < reachable_advsize; reachable_index++) {
-            uint64_t index = adv_vertices_reachable[reachable_index];
-            fprintf(stderr, "Reachable #%" PRIu64 ": vertex index %" PRIu64 ", ", reachable_index, index);
-
-            fprintf(stderr, "[");
-            bool first = true;
-            for (int j = 0; j < 3; j++) {
-                if (opt_decision_map[index][j] != -1) {
-                    if (!first) {
-                        fprintf(stderr, ",");
-                    } else {
-                        first = false;
-                    }
-
-                    fprintf(stderr, "%" PRIi8 "", opt_decision_map[index][j] );
-                }
+        for (uint64_t word = 0; word < adv_reachable.words; word++) {
+            uint64_t bits = adv_reachable.data[word];
+            while (bits != 0) {
+                uint64_t index = word * 64 + std::countr_zero(bits);
+                bits &= bits - 1;
+                uint64_t reachable_index = adv_reachable.rank(index);
+                fprintf(stderr, "Reachable #%" PRIu64 ": vertex index %" PRIu64 ", ", reachable_index, index);
+
+                print_request_set(opt_decisions[reachable_index]);
+                fprintf(stderr, "\n");
             }
-            fprintf(stderr, "]\n");
         }
     }
 
     void reachable_reset_potentials() {
-        for (uint64_t reachable_index = 0; reachable_index < reachable_advsize; reachable_index++) {
-            uint64_t index = adv_vertices_reachable[reachable_index];
-            adv_vertices[index] = 0;
+        forget_adv_min();
+        for (uint64_t word = 0; word < adv_reachable.words; word++) {
+            uint64_t bits = adv_reachable.data[word];
+            while (bits != 0) {
+                uint64_t index = word * 64 + std::countr_zero(bits);
+                bits &= bits - 1;
+                adv_vertices[index] = 0;
+            }
         }
 
-        for (uint64_t reachable_index = 0; reachable_index < reachable_algsize; reachable_index++) {
-            uint64_t index = alg_vertices_reachable[reachable_index];
-            alg_vertices[index] = 0;
+        for (uint64_t word = 0; word < alg_reachable.words; word++) {
+            uint64_t bits = alg_reachable.data[word];
+            while (bits != 0) {
+                uint64_t index = word * 64 + std::countr_zero(bits);
+                bits &= bits - 1;
+                set_alg_potential(index, 0);
+            }
         }
+        consolidate_alg_potentials();
     }
 
 
@@ -3,8 +3,11 @@
 #pragma once
 
 #include <omp.h>
+#include <numeric>
+#include <optional>
 #include "../pairwise_wf_manager.hpp"
 #include "../permutation_graph.hpp"
+#include "../data_structures/block_potentials.hpp"
 
 template <short SIZE> class pairwise_game_graph {
 private:
@@ -12,20 +15,31 @@ private:
     bool *adv_vertices_visited = nullptr;
 public:
     short *alg_vertices = nullptr;
+    // If set, the ALG potentials are stored here in a compressed form instead of alg_vertices, as in game_graph.
+    block_potentials *alg_compact = nullptr;
     uint64_t algsize = 0;
     short *adv_vertices = nullptr;
     uint64_t advsize = 0;
     pairwise_wf_manager<SIZE> &wf;
     permutation_graph<SIZE> &pg;
 
-    pairwise_game_graph(pairwise_wf_manager<SIZE> &w, permutation_graph<SIZE> &p) : wf(w), pg(p) {
-        advsize = wf.reachable_wfs.size() * factorial[SIZE];
-        adv_vertices = new short[advsize];
-        algsize = wf.reachable_wfs.size() * factorial[SIZE] * SIZE;
-        alg_vertices = new short[algsize];
+    // The min ADV potential, if known without a pass over adv_vertices; update_adv() computes it
+    // by a reduction along the way, as in game_graph.
+    mutable std::optional<short> known_adv_min{};
 
-        for (int i = 0; i < algsize; i++) {
-            alg_vertices[i] = 0;
+    pairwise_game_graph(pairwise_wf_manager<SIZE> &w, permutation_graph<SIZE> &p, bool compact_alg = false)
+        : wf(w), pg(p) {
+        advsize = wf.reachable_workfunctions * factorial[SIZE];
+        adv_vertices = new short[advsize];
+        algsize = wf.reachable_workfunctions * factorial[SIZE] * SIZE;
+        if (compact_alg) {
+            // One block per work function.
+            alg_compact = new block_potentials(algsize, factorial[SIZE] * SIZE, potential_unit());
+        } else {
+            alg_vertices = new short[algsize];
+            for (int i = 0; i < algsize; i++) {
+                alg_vertices[i] = 0;
+            }
         }
 
         for (int i = 0; i < advsize; i++) {
@@ -38,8 +52,41 @@ public:
     {
         delete[] adv_vertices;
         delete[] alg_vertices;
+        delete alg_compact;
+    }
+
+    inline short alg_potential(uint64_t index) const {
+        if (alg_compact != nullptr) {
+            return alg_compact->get(index);
+        }
+        return alg_vertices[index];
+    }
+
+    inline void set_alg_potential(uint64_t index, short pot) {
+        if (alg_compact != nullptr) {
+            alg_compact->set(index, pot);
+        } else {
+            alg_vertices[index] = pot;
+        }
+    }
+
+    // Must be called after every pass which writes ALG potentials, before they are read again.
+    void consolidate_alg_potentials() {
+        if (alg_compact != nullptr) {
+            alg_compact->consolidate();
+        }
     }
 
+    // All potentials are sums of edge costs, so they are multiples of the gcd of all edge costs.
+    short potential_unit() {
+        short unit = ALG_MULTIPLIER;
+        for (uint64_t wf_index = 0; wf_index < wf.reachable_workfunctions; wf_index++) {
+            for (short r = 0; r < SIZE; r++) {
+                unit = std::gcd(unit, adv_cost(wf_index, r));
+            }
+        }
+        return unit;
+    }
 
     [[nodiscard]] std::pair<unsigned long int, unsigned long int> decode_adv(uint64_t index) const {
         return {index / factorial[SIZE], index % factorial[SIZE]};
@@ -72,7 +119,7 @@ public:
         auto [wf_index, perm_index, req] = decode_alg(index);
         fprintf(fout, "ALG vertex: index %lu, permutation: ", index);
         pg.all_perms[perm_index].print(fout, false);
-        fprintf(fout, ", request %lu, work function %lu, potential %hd.\n", req, wf_index, alg_vertices[index]);
+        fprintf(fout, ", request %lu, work function %lu, potential %hd.\n", req, wf_index, alg_potential(index));
         // wf.reachable_wfs[wf_index].print();
     }
 
@@ -86,17 +133,23 @@ public:
         return ALG_MULTIPLIER*(perm_one.position(req) + perm_one.inversions_wrt(perm_two));
     }
 
-    short min_adv_potential() {
+    short min_adv_potential() const {
+        if (known_adv_min.has_value()) {
+            return *known_adv_min;
+        }
         short m = std::numeric_limits<short>::max();
+#pragma omp parallel for reduction(min:m)
         for (uint64_t index = 0; index < advsize; index++) {
             m = std::min(m, adv_vertices[index]);
         }
+        known_adv_min = m;
         return m;
     }
 
     bool update_adv() {
         bool any_potential_changed = false;
-#pragma omp parallel for
+        short adv_min = std::numeric_limits<short>::max();
+#pragma omp parallel for reduction(||:any_potential_changed) reduction(min:adv_min)
         for (uint64_t index = 0; index < advsize; index++) {
             auto [wf_index, perm_index] = decode_adv(index);
             if(GRAPH_DEBUG) {
@@ -115,14 +168,15 @@ public:
                             index, r, adv_cost_s);
                     // ADV potential update.
                     fprintf(stderr, "Phi_x (%hd) - d_yx (%hd) = %hd.\n",
-                            alg_vertices[alg_index], adv_cost_s,
-                            alg_vertices[alg_index] - adv_cost_s);
+                            alg_potential(alg_index), adv_cost_s,
+                            alg_potential(alg_index) - adv_cost_s);
                 }
-                if (alg_vertices[alg_index] - adv_cost_s > new_pot) {
-                    new_pot = alg_vertices[alg_index] - adv_cost_s;
+                if (alg_potential(alg_index) - adv_cost_s > new_pot) {
+                    new_pot = alg_potential(alg_index) - adv_cost_s;
                 }
             }
 
+            adv_min = std::min(adv_min, new_pot);
             if (adv_vertices[index] != new_pot) {
                 any_potential_changed = true;
                 if(GRAPH_DEBUG) {
@@ -132,12 +186,13 @@ public:
                 adv_vertices[index] = new_pot;
             }
         }
+        known_adv_min = adv_min;
         return any_potential_changed;
     }
 
     bool update_alg() {
         bool any_potential_changed = false;
-#pragma omp parallel for
+#pragma omp parallel for reduction(||:any_potential_changed)
         for (uint64_t index = 0; index < algsize; index++) {
             auto [wf_index, perm_index, req] = decode_alg(index);
             if(GRAPH_DEBUG) {
@@ -163,23 +218,24 @@ public:
                 }
             }
 
-            if (alg_vertices[index] != new_pot) {
+            if (alg_potential(index) != new_pot) {
                 any_potential_changed = true;
                 if(GRAPH_DEBUG) {
                     fprintf(stderr, "ALG vertex %" PRIu64 " changed its potential from %hd to %hd.\n",
-                            index, alg_vertices[index], new_pot);
+                            index, alg_potential(index), new_pot);
                 }
-                alg_vertices[index] = new_pot;
+                set_alg_potential(index, new_pot);
 
             }
         }
+        consolidate_alg_potentials();
 
         return any_potential_changed;
     }
 
     bool update_alg_stay_or_mtf() {
         bool any_potential_changed = false;
-#pragma omp parallel for
+#pragma omp parallel for reduction(||:any_potential_changed)
         for (uint64_t index = 0; index < algsize; index++) {
             auto [wf_index, perm_index, req] = decode_alg(index);
             if(GRAPH_DEBUG) {
@@ -210,23 +266,24 @@ public:
             }
 
 
-            if (alg_vertices[index] != new_pot) {
+            if (alg_potential(index) != new_pot) {
                 any_potential_changed = true;
                 if(GRAPH_DEBUG) {
                     fprintf(stderr, "ALG vertex %" PRIu64 " changed its potential from %hd to %hd.\n",
-                            index, alg_vertices[index], new_pot);
+                            index, alg_potential(index), new_pot);
                 }
-                alg_vertices[index] = new_pot;
+                set_alg_potential(index, new_pot);
 
             }
         }
+        consolidate_alg_potentials();
 
         return any_potential_changed;
     }
 
     bool update_alg_request_moves_forward() {
         bool any_potential_changed = false;
-#pragma omp parallel for
+#pragma omp parallel for reduction(||:any_potential_changed)
         for (uint64_t index = 0; index < algsize; index++) {
             auto [wf_index, perm_index, req] = decode_alg(index);
             if(GRAPH_DEBUG) {
@@ -263,16 +320,17 @@ public:
                 }
             }
 
-            if (alg_vertices[index] != new_pot) {
+            if (alg_potential(index) != new_pot) {
                 any_potential_changed = true;
                 if(GRAPH_DEBUG) {
                     fprintf(stderr, "ALG vertex %" PRIu64 " changed its potential from %hd to %hd.\n",
-                            index, alg_vertices[index], new_pot);
+                            index, alg_potential(index), new_pot);
                 }
-                alg_vertices[index] = new_pot;
+                set_alg_potential(index, new_pot);
 
             }
         }
+        consolidate_alg_potentials();
 
         return any_potential_changed;
     }
@@ -333,7 +391,7 @@ public:
                 for (unsigned long p = 0; p < factorial[SIZE]; p++) {
                     unsigned long next_adv_index = encode_adv(wf_index, p);
                     short alg_cost_s = alg_cost(perm_index, p, request);
-                    if (adv_vertices[next_adv_index] + alg_cost_s == alg_vertices[index]) {
+                    if (adv_vertices[next_adv_index] + alg_cost_s == alg_potential(index)) {
                         tight_size++;
                     }
                 }
@@ -345,7 +403,7 @@ public:
                     unsigned long next_adv_index = encode_adv(wf_index, p);
                     short alg_cost_s = alg_cost(perm_index, p, request);
                     // We only print the first potential-saving move and finish.
-                    if (!something_printed && (adv_vertices[next_adv_index] + alg_cost_s <= alg_vertices[index])) {
+                    if (!something_printed && (adv_vertices[next_adv_index] + alg_cost_s <= alg_potential(index))) {
                         something_printed = true;
 
                         fprintf(fout, "Given request %lu, ALG switches to ", request);
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <omp.h>
+#include <chrono>
+#include <optional>
+#include "game_graph.hpp"
+
+// A record per round of the potential iteration, written as one JSON object per line:
+// the numbers of changed ADV and ALG potentials, the time of each phase, the range of the potentials
+// with a histogram of the ADV ones, and the threads used.
+//
+// The bandwidth is an estimate for full sweeps: each ADV vertex reads SIZE ALG potentials and each
+// ALG vertex reads the ADV potentials of its moves in the graph's class of ALG moves, each of them written once.
+// For the worklist schedule, which skips clean vertices, it is an upper bound.
+//
+// The ADV range and histogram come from a single parallel pass, in which every thread counts the potentials
+// by their value; the counts are summed and then read off in value order.
+
+constexpr int TELEMETRY_HISTOGRAM_BINS = 8;
+
+template <short SIZE> class iteration_telemetry {
+public:
+    FILE* out = nullptr;
+    std::chrono::steady_clock::time_point phase_start;
+    double adv_ms = 0;
+    double alg_ms = 0;
+    // The average number of ALG moves per ALG vertex, for the class it was computed for.
+    std::optional<alg_moves> counted_move_class{};
+    double alg_moves_per_vertex = 0;
+
+    explicit iteration_telemetry(const std::string& filename) {
+        out = fopen(filename.c_str(), "w");
+        if (out == nullptr) {
+            PRINT_AND_ABORT("The telemetry file %s could not be opened.\n", filename.c_str());
+        }
+    }
+
+    iteration_telemetry(const iteration_telemetry&) = delete;
+    iteration_telemetry& operator=(const iteration_telemetry&) = delete;
+
+    ~iteration_telemetry() {
+        fclose(out);
+    }
+
+    void start_phase() {
+        phase_start = std::chrono::steady_clock::now();
+    }
+
+    double end_phase() {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - phase_start).count();
+    }
+
+    // Fused schedules have a single phase, reported as the ADV one.
+    void end_adv_phase() {
+        adv_ms = end_phase();
+        alg_ms = 0;
+    }
+
+    void end_alg_phase() {
+        alg_ms = end_phase();
+    }
+
+    void record(const game_graph<SIZE>& g, uint64_t round) {
+        constexpr int VALUES = 1 << 16;
+        std::vector<uint64_t> adv_counts(VALUES, 0);
+#pragma omp parallel
+        {
+            std::vector<uint64_t> local_counts(VALUES, 0);
+#pragma omp for nowait
+            for (uint64_t i = 0; i < g.advsize; i++) {
+                local_counts[g.adv_vertices[i] - std::numeric_limits<short>::min()]++;
+            }
+#pragma omp critical
+            for (int v = 0; v < VALUES; v++) {
+                adv_counts[v] += local_counts[v];
+            }
+        }
+        int first_value = 0, last_value = VALUES - 1;
+        while (first_value < last_value && adv_counts[first_value] == 0) {
+            first_value++;
+        }
+        while (last_value > first_value && adv_counts[last_value] == 0) {
+            last_value--;
+        }
+        const short adv_min = (short) (first_value + std::numeric_limits<short>::min());
+        const short adv_max = (short) (last_value + std::numeric_limits<short>::min());
+
+        short alg_min = std::numeric_limits<short>::max(), alg_max = std::numeric_limits<short>::min();
+#pragma omp parallel for reduction(min:alg_min) reduction(max:alg_max)
+        for (uint64_t i = 0; i < g.algsize; i++) {
+            short pot = g.alg_potential(i);
+            alg_min = std::min(alg_min, pot);
+            alg_max = std::max(alg_max, pot);
+        }
+
+        // Equal-width bins between the min and the max ADV potential.
+        std::array<uint64_t, TELEMETRY_HISTOGRAM_BINS> histogram{};
+        const int width = (adv_max - adv_min) / TELEMETRY_HISTOGRAM_BINS + 1;
+        for (int v = first_value; v <= last_value; v++) {
+            histogram[(v - first_value) / width] += adv_counts[v];
+        }
+
+        if (counted_move_class != g.alg_move_class) {
+            counted_move_class = g.alg_move_class;
+            alg_moves_per_vertex = g.average_alg_moves();
+        }
+        const double adv_bytes = (double) g.advsize * (SIZE + 1) * sizeof(short);
+        const double alg_bytes = (double) g.algsize * (alg_moves_per_vertex + 1) * sizeof(short);
+        const double total_ms = adv_ms + alg_ms;
+        const double gbps = total_ms > 0 ? (adv_bytes + alg_bytes) / (total_ms * 1e6) : 0;
+
+        fprintf(out, "{\"ratio\": %Lf, \"round\": %" PRIu64 ", \"adv_changed\": %" PRIu64 ", \"alg_changed\": %" PRIu64
+                ", \"adv_ms\": %.3f, \"alg_ms\": %.3f, \"adv_min\": %hd, \"adv_max\": %hd, \"alg_min\": %hd"
+                ", \"alg_max\": %hd, \"adv_histogram_width\": %d, \"adv_histogram\": [",
+                g.ratio, round, g.adv_changes, g.alg_changes, adv_ms, alg_ms, adv_min, adv_max, alg_min, alg_max, width);
+        for (int b = 0; b < TELEMETRY_HISTOGRAM_BINS; b++) {
+            fprintf(out, b == 0 ? "%" PRIu64 : ", %" PRIu64, histogram[b]);
+        }
+        fprintf(out, "], \"est_gbps\": %.2f, \"threads\": %d}\n", gbps, omp_get_max_threads());
+        fflush(out);
+    }
+};
@@ -84,7 +84,7 @@ int main() {
             }
 
             if (!std::filesystem::exists(reachable_vertices_filename)) {
-                g.wfa_reachable_via_last_three();
+                g.wfa_reachable_via(true);
                 g.serialize_reachable_arrays(reachable_vertices_filename);
             }
 
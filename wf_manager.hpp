@@ -8,12 +8,19 @@
 #include <iostream>
 #include <fstream>
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
 #include "permutation_graph.hpp"
 #include "workfunction.hpp"
 //#include "parallel-hashmap/parallel_hashmap/phmap.h" // The code requires the parallel-hashmap header-only library.
 #include "wf/double_zobrist.hpp"
 #include "data_structures/char_flat_set.hpp"
 #include "data_structures/file_based_queue.hpp"
+#include "data_structures/sharded_hash_map.hpp"
+#include "data_structures/exact_wf_table.hpp"
+#include "data_structures/mapped_file.hpp"
 
 
 template <int SIZE>
@@ -28,11 +35,24 @@ public:
     std::array<unsigned int, SIZE>* adjacent_functions_arr = nullptr;
     std::array<short, SIZE>* min_update_costs_arr = nullptr;
 
+    // Canonical orbit mode. Work functions which differ only by a relabeling of the list elements
+    // are symmetric in the game, so only one representative per orbit is stored. For each adjacency,
+    // the relabeling (a permutation id, applied via right composition) which maps the updated work function
+    // onto the stored representative.
+    bool canonical = false;
+    std::array<unsigned int, SIZE>* adjacent_relabelings_arr = nullptr;
+
     // std::vector<std::array<unsigned int, SIZE>> adjacent_functions;
     // std::vector<std::array<short, SIZE>> min_update_costs;
     std::unordered_map<uint64_t, unsigned int> hash_to_index;
+    // Replaces hash_to_index with EXACT_WORKFUNCTION_KEYS.
+    exact_wf_table<SIZE> exact_index;
 
-    wf_manager(permutation_graph<SIZE>& p) : pm(p) {
+    // If the reachable work functions were loaded from a sectioned file, the arrays above point into this mapping.
+    mapped_file* reachable_mapping = nullptr;
+
+    // Canonical orbits need the right composition table of the permutation graph to be populated.
+    wf_manager(permutation_graph<SIZE>& p, bool canonical_orbits = false) : pm(p), canonical(canonical_orbits) {
         zobrist = new std::array<std::array<uint64_t, diameter_bound(SIZE) + 1>, factorial[SIZE]>();
         for (int i = 0; i < factorial[SIZE]; i++) {
             for (int v = 0; v < diameter_bound(SIZE) + 1; v++) {
@@ -45,18 +65,22 @@ public:
 
     ~wf_manager() {
         delete zobrist;
+        delete reachable_mapping;
     }
 
     static void initialize_inversions() {
-        if (!inversions_ready) {
-            invs->vals[0] = 0;
-            for (int i = 1; i < factorial[TESTSIZE]; i++) {
-                invs->vals[i] = diameter_bound(TESTSIZE);
+        if (!inversions_ready_for<SIZE>) {
+            if (inversion_wf<SIZE> == nullptr) {
+                inversion_wf<SIZE> = new workfunction<SIZE>{};
+            }
+            inversion_wf<SIZE>->vals[0] = 0;
+            for (int i = 1; i < factorial[SIZE]; i++) {
+                inversion_wf<SIZE>->vals[i] = diameter_bound(SIZE);
             }
 
-            dynamic_update(invs);
+            dynamic_update(inversion_wf<SIZE>);
         }
-        inversions_ready = true;
+        inversions_ready_for<SIZE> = true;
     }
 
     void flat_update(workfunction<SIZE>* wf, short req) {
@@ -87,7 +111,7 @@ public:
         }
     }
 
-    uint64_t hash(workfunction<SIZE>* wf) {
+    uint64_t hash(const workfunction<SIZE>* wf) const {
         uint64_t ret = 0;
         for (int i = 0; i < factorial[SIZE]; i++) {
             ret ^= (*zobrist)[i][wf->vals[i]];
@@ -140,12 +164,150 @@ public:
     }
 
 
-    // Static, but requires the pg pointer to be populated.
+    // Closes the work function under the permutahedron metric: vals[j] = min_i (vals[i] + dist(i, j)),
+    // where only entries with a value below diameter_bound(SIZE) act as sources.
+    // Static, but requires the perm_graph<SIZE> pointer to be populated.
     static void dynamic_update(workfunction<SIZE>* wf) {
+        dynamic_update_simd(wf);
+    }
+
+    // A single-pass version of the closure. The sources are counting-sorted by value and merged
+    // with a FIFO queue of relaxed entries, both of which are nondecreasing in value, so every entry
+    // is finalized exactly once, as in a BFS from all sources at once.
+    static void dynamic_update_buckets(workfunction<SIZE>* wf) {
+        constexpr short diam = diameter_bound(SIZE);
+        std::array<unsigned int, diam + 1> bucket_starts{};
+        std::array<unsigned int, factorial[SIZE]> sorted;
+        std::array<unsigned int, factorial[SIZE]> fifo;
+
+        for (unsigned int i = 0; i < factorial[SIZE]; i++) {
+            if (wf->vals[i] < diam) {
+                bucket_starts[wf->vals[i] + 1]++;
+            }
+        }
+        for (short value = 0; value < diam; value++) {
+            bucket_starts[value + 1] += bucket_starts[value];
+        }
+        const unsigned int sources = bucket_starts[diam];
+        for (unsigned int i = 0; i < factorial[SIZE]; i++) {
+            if (wf->vals[i] < diam) {
+                sorted[bucket_starts[wf->vals[i]]++] = i;
+            }
+        }
+
+        unsigned int sorted_pos = 0;
+        unsigned int fifo_head = 0;
+        unsigned int fifo_tail = 0;
+        // The sort key of the current sorted entry is recovered from its bucket, as the value may have dropped.
+        short sorted_value = 0;
+        while (sorted_pos < sources || fifo_head < fifo_tail) {
+            unsigned int i = 0;
+            short value = 0;
+            if (sorted_pos < sources) {
+                while (sorted_value < diam && bucket_starts[sorted_value] <= sorted_pos) {
+                    sorted_value++;
+                }
+            }
+            if (fifo_head < fifo_tail && (sorted_pos >= sources || wf->vals[fifo[fifo_head]] <= sorted_value)) {
+                i = fifo[fifo_head++];
+                value = wf->vals[i];
+            } else {
+                i = sorted[sorted_pos++];
+                value = sorted_value;
+                if (wf->vals[i] != value) {
+                    // Stale, the entry was relaxed below its initial value and went through the queue.
+                    continue;
+                }
+            }
+
+            if (value >= diam) {
+                break;
+            }
+            for (uint64_t adj : perm_graph<SIZE>->adjacencies[i]) {
+                if (value + 1 < wf->vals[adj]) {
+                    wf->vals[adj] = (short) (value + 1);
+                    fifo[fifo_tail++] = adj;
+                }
+            }
+        }
+    }
+
+#if defined(__x86_64__)
+    // The adjacencies of the permutahedron, one array per swap direction.
+    static const std::array<std::array<int, factorial[SIZE]>, SIZE - 1>& adjacencies_by_direction() {
+        static const std::array<std::array<int, factorial[SIZE]>, SIZE - 1> table = [] {
+            std::array<std::array<int, factorial[SIZE]>, SIZE - 1> t{};
+            for (unsigned int i = 0; i < factorial[SIZE]; i++) {
+                for (int d = 0; d < SIZE - 1; d++) {
+                    t[d][i] = (int) perm_graph<SIZE>->adjacencies[i][d];
+                }
+            }
+            return t;
+        }();
+        return table;
+    }
+
+    // A vectorized version of the closure. Relaxes eight entries along all SIZE-1 directions at once,
+    // in place, and repeats the rounds until nothing changes; at most diameter_bound(SIZE) + 1 rounds.
+    __attribute__((target("avx2")))
+    static void dynamic_update_avx2(workfunction<SIZE>* wf) {
+        constexpr short diam = diameter_bound(SIZE);
+        constexpr uint64_t padded = ((factorial[SIZE] + 7) / 8) * 8;
+        const auto& adj = adjacencies_by_direction();
+        alignas(32) std::array<int, padded> v;
+        for (uint64_t i = 0; i < padded; i++) {
+            v[i] = i < factorial[SIZE] ? wf->vals[i] : diam;
+        }
+
+        const __m256i one = _mm256_set1_epi32(1);
+        const __m256i diam_v = _mm256_set1_epi32(diam);
+        const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        bool changed = true;
+        while (changed) {
+            __m256i any = _mm256_setzero_si256();
+            for (uint64_t p = 0; p < factorial[SIZE]; p += 8) {
+                // Lanes past the end point at themselves and never change.
+                const __m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32((int) (factorial[SIZE] - p)), lane);
+                __m256i cur = _mm256_load_si256(reinterpret_cast<const __m256i*>(v.data() + p));
+                __m256i best = cur;
+                for (int d = 0; d < SIZE - 1; d++) {
+                    __m256i idx = _mm256_maskload_epi32(adj[d].data() + p, valid);
+                    idx = _mm256_blendv_epi8(_mm256_add_epi32(_mm256_set1_epi32((int) p), lane), idx, valid);
+                    __m256i neighbor = _mm256_i32gather_epi32(v.data(), idx, 4);
+                    // Only neighbors below the diameter act as sources.
+                    __m256i is_source = _mm256_cmpgt_epi32(diam_v, neighbor);
+                    __m256i candidate = _mm256_blendv_epi8(cur, _mm256_add_epi32(neighbor, one), is_source);
+                    best = _mm256_min_epi32(best, candidate);
+                }
+                any = _mm256_or_si256(any, _mm256_cmpgt_epi32(cur, best));
+                _mm256_store_si256(reinterpret_cast<__m256i*>(v.data() + p), best);
+            }
+            changed = !_mm256_testz_si256(any, any);
+        }
+
+        for (uint64_t i = 0; i < factorial[SIZE]; i++) {
+            wf->vals[i] = (short) v[i];
+        }
+    }
+#endif
+
+    // The vectorized closure if the CPU supports AVX2, the bucketed one otherwise.
+    static void dynamic_update_simd(workfunction<SIZE>* wf) {
+#if defined(__x86_64__)
+        if (__builtin_cpu_supports("avx2")) {
+            dynamic_update_avx2(wf);
+            return;
+        }
+#endif
+        dynamic_update_buckets(wf);
+    }
+
+    // The original closure, in O(diameter * SIZE!) per work function. Kept as a reference.
+    static void dynamic_update_quadratic(workfunction<SIZE>* wf) {
         for (short value = 0; value < diameter_bound(SIZE); value++) {
             for (int i = 0; i < factorial[SIZE]; i++) {
                 if (wf->vals[i] == value) {
-                    for (uint64_t adj : pg->adjacencies[i]) {
+                    for (uint64_t adj : perm_graph<SIZE>->adjacencies[i]) {
                         wf->vals[adj] = std::min((short)(value + 1), wf->vals[adj]);
                     }
                 }
@@ -161,14 +323,53 @@ public:
         cut_minimum(&new_wf);
         dynamic_update(&new_wf);
         // new_wf.validate();
-        uint64_t new_wf_index = hash_to_index[hash(&new_wf)];
+        uint64_t new_wf_index = index_of(&new_wf);
         return new_wf_index;
     }
 
+    static constexpr uint64_t NOT_REACHABLE = UINT64_MAX;
+
+    // The index of a reachable work function, or NOT_REACHABLE. Only compares the hashes
+    // without EXACT_WORKFUNCTION_KEYS.
+    uint64_t index_of(const workfunction<SIZE>* wf) const {
+        if constexpr (EXACT_WORKFUNCTION_KEYS) {
+            uint64_t index = exact_index.find(hash(wf), exact_wf_table<SIZE>::pack(*wf));
+            return index == exact_wf_table<SIZE>::NOT_FOUND ? NOT_REACHABLE : index;
+        } else {
+            auto it = hash_to_index.find(hash(wf));
+            return it == hash_to_index.end() ? NOT_REACHABLE : it->second;
+        }
+    }
+
+    void report_exact_index() const {
+        fprintf(stderr, "Exact work function keys: %" PRIu64 " work functions of %" PRIu64 " words, %.1lf MB,"
+                " %" PRIu64 " hash collisions.\n", exact_index.size(), exact_wf_table<SIZE>::RECORD_WORDS,
+                exact_index.memory_bytes() / (1024.0 * 1024.0), exact_index.collisions.load());
+    }
+
     uint64_t adjacency(uint64_t wf_index, short request) {
         return adjacent_functions_arr[wf_index][request];
     }
 
+    uint64_t relabeling(uint64_t wf_index, short request) {
+        return adjacent_relabelings_arr[wf_index][request];
+    }
+
+    // The relabeling under which the work function has the smallest hash. The relabeled work function
+    // is the representative of its orbit.
+    uint64_t canonical_relabeling(const workfunction<SIZE>* wf) const {
+        uint64_t best = 0;
+        uint64_t best_hash = hash_under_right_composition(wf, 0);
+        for (uint64_t perm_id = 1; perm_id < factorial[SIZE]; perm_id++) {
+            uint64_t h = hash_under_right_composition(wf, perm_id);
+            if (h < best_hash) {
+                best_hash = h;
+                best = perm_id;
+            }
+        }
+        return best;
+    }
+
     short update_cost(uint64_t wf_index, short request) {
         return min_update_costs_arr[wf_index][request];
     }
@@ -211,7 +412,7 @@ public:
         char_flat_set reachable_hashes(35);
 
         // phmap::flat_hash_set<uint64_t> reachable_hashes;
-        workfunction<SIZE> initial = *invs;
+        workfunction<SIZE> initial = *inversion_wf<SIZE>;
         std::queue<workfunction<SIZE>> q;
         file_based_queue fbq(std::string("queue.bin"));
 
@@ -252,37 +453,56 @@ public:
         return reachable_hashes.insertions;
     }
 
+    // Sections: the work functions, their adjacencies, the min update costs and,
+    // in the canonical orbit mode, the adjacency relabelings.
     void serialize_reachable(const std::string& reachable_filename) const {
-        FILE* binary_file = fopen(reachable_filename.c_str(), "wb");
-        size_t written = 0;
-
-        written = fwrite(&reachable_workfunctions, sizeof(uint64_t), 1, binary_file);
-        if (written != 1) {
-            PRINT_AND_ABORT("The number of reachable workfunctions was not written correctly.");
+        const uint64_t n = reachable_workfunctions;
+        std::vector<uint64_t> section_bytes = {n * sizeof(workfunction<SIZE>),
+                                               n * sizeof(std::array<unsigned int, SIZE>),
+                                               n * sizeof(std::array<short, SIZE>)};
+        if (canonical) {
+            section_bytes.push_back(n * sizeof(std::array<unsigned int, SIZE>));
         }
 
-        written = fwrite(reachable_wfs_arr, sizeof(workfunction<SIZE>), reachable_workfunctions,
-                         binary_file);
-        if (written != reachable_workfunctions) {
-            PRINT_AND_ABORT("The array of reachable work functions was not written correctly.");
+        sectioned_file_writer writer(reachable_filename, section_bytes);
+        writer.write(0, reachable_wfs_arr, section_bytes[0]);
+        writer.write(1, adjacent_functions_arr, section_bytes[1]);
+        writer.write(2, min_update_costs_arr, section_bytes[2]);
+        if (canonical) {
+            writer.write(3, adjacent_relabelings_arr, section_bytes[3]);
         }
+        writer.close();
+    }
 
-        written = fwrite(adjacent_functions_arr, sizeof(std::array<unsigned int, SIZE>), reachable_workfunctions,
-                         binary_file);
-        if (written != reachable_workfunctions) {
-            PRINT_AND_ABORT("The array of work function adjacencies was not written correctly.");
+    // The arrays are used in place and never written after loading, so the mapping is read-only.
+    void map_reachable(const std::string& reachable_filename) {
+        delete reachable_mapping;
+        reachable_mapping = new mapped_file(reachable_filename, false);
+        if (reachable_mapping->sections() != (canonical ? 4 : 3)) {
+            PRINT_AND_ABORT("The file %s has %" PRIu32 " sections, which does not match the canonical orbit mode.\n",
+                            reachable_filename.c_str(), reachable_mapping->sections());
         }
 
-        written = fwrite(min_update_costs_arr, sizeof(std::array<short, SIZE>), reachable_workfunctions,
-                         binary_file);
-        if (written != reachable_workfunctions) {
-            PRINT_AND_ABORT("The array of min update costs for each workfunction was not written correctly.");
+        reachable_workfunctions = reachable_mapping->elements<workfunction<SIZE>>(0);
+        if (reachable_mapping->elements<std::array<unsigned int, SIZE>>(1) != reachable_workfunctions ||
+            reachable_mapping->elements<std::array<short, SIZE>>(2) != reachable_workfunctions) {
+            PRINT_AND_ABORT("The sections of %s differ in length.\n", reachable_filename.c_str());
+        }
+        reachable_wfs_arr = reachable_mapping->section<workfunction<SIZE>>(0);
+        adjacent_functions_arr = reachable_mapping->section<std::array<unsigned int, SIZE>>(1);
+        min_update_costs_arr = reachable_mapping->section<std::array<short, SIZE>>(2);
+        if (canonical) {
+            adjacent_relabelings_arr = reachable_mapping->section<std::array<unsigned int, SIZE>>(3);
         }
-
-        fclose(binary_file);
     }
 
     void deserialize_reachable(const std::string& reachable_filename) {
+        if (mapped_file::is_sectioned(reachable_filename)) {
+            map_reachable(reachable_filename);
+            return;
+        }
+
+        // The unversioned format: the count followed by the arrays.
         FILE* binary_file = fopen(reachable_filename.c_str(), "rb");
         size_t read = 0;
         read = fread(&reachable_workfunctions, sizeof(uint64_t), 1, binary_file);
@@ -312,10 +532,30 @@ public:
             PRINT_AND_ABORT("The array of min update costs for each workfunction was not read correctly.");
         }
 
+        if (canonical) {
+            adjacent_relabelings_arr = new std::array<unsigned int, SIZE>[reachable_workfunctions];
+            read = fread(adjacent_relabelings_arr, sizeof(std::array<unsigned int, SIZE>),
+                         reachable_workfunctions, binary_file);
+            if (read != reachable_workfunctions) {
+                PRINT_AND_ABORT("The array of adjacency relabelings was not read correctly.");
+            }
+        }
+
         fclose(binary_file);
     }
 
     void fill_hash_to_index() {
+        if constexpr (EXACT_WORKFUNCTION_KEYS) {
+            exact_index.clear();
+            exact_index.resize(reachable_workfunctions);
+#pragma omp parallel for
+            for (uint64_t i = 0; i < reachable_workfunctions; i++) {
+                exact_index.store(i, exact_wf_table<SIZE>::pack(reachable_wfs_arr[i]));
+                exact_index.insert(hash(&reachable_wfs_arr[i]), i);
+            }
+            report_exact_index();
+            return;
+        }
         hash_to_index.clear();
         for (int i = 0; i < reachable_workfunctions; i++) {
             hash_to_index[hash(&(reachable_wfs_arr[i]))] = i;
@@ -333,7 +573,186 @@ public:
         }
     }
 
+    // Parents expanded at once by initialize_reachable_from_scratch(). Bounds the memory for the children,
+    // which is SIZE work functions per parent.
+    static constexpr uint64_t REACHABLE_BFS_CHUNK = 1LLU << 14;
+
+    // A level-synchronous parallel version of the BFS below. The parents of a level are expanded in chunks;
+    // the children of a chunk are computed in parallel and deduplicated through sharded hash maps.
+    // A new work function is assigned to its first occurrence in the order (parent index, request), which
+    // is the order of the sequential BFS queue, so the indices and the serialized file are identical.
+    //
+    // With canonical orbits, every child is replaced by its orbit representative before deduplication.
+    // The initial work function is kept as it is, so that the initial ADV vertex stays (0, 0); at worst,
+    // its orbit is stored twice.
+    //
+    // With EXACT_WORKFUNCTION_KEYS, exact_index takes the place of discovered, and the children of a chunk
+    // are claimed through an exact_wf_table of their own, so both compare the work functions themselves.
     void initialize_reachable_from_scratch() {
+        using exact_table = exact_wf_table<SIZE>;
+        std::vector<workfunction<SIZE>> reachable_wfs_vec;
+        std::vector<std::array<uint64_t, SIZE>> adjacencies_by_hash;
+        std::vector<std::array<unsigned int, SIZE>> adjacencies_by_index;
+        std::vector<std::array<short, SIZE>> min_update_costs_vec;
+        std::vector<std::array<unsigned int, SIZE>> relabelings_vec;
+
+        // Hash to the index of the work function.
+        sharded_hash_map discovered;
+        // Hash to the first slot of the current chunk in which it was found.
+        sharded_hash_map claims;
+        exact_table exact_claims;
+
+        workfunction<SIZE> initial = *inversion_wf<SIZE>;
+        if constexpr (EXACT_WORKFUNCTION_KEYS) {
+            exact_index.clear();
+            exact_index.resize(1);
+            exact_index.store(0, exact_table::pack(initial));
+            exact_index.insert(hash(&initial), 0);
+        } else {
+            discovered.insert(hash(&initial), 0);
+        }
+        reachable_wfs_vec.push_back(initial);
+
+        uint64_t level_start = 0;
+        uint64_t level = 0;
+        while (level_start < reachable_wfs_vec.size()) {
+            const uint64_t level_end = reachable_wfs_vec.size();
+            for (uint64_t chunk_start = level_start; chunk_start < level_end; chunk_start += REACHABLE_BFS_CHUNK) {
+                const uint64_t chunk_end = std::min(chunk_start + REACHABLE_BFS_CHUNK, level_end);
+                const uint64_t slots = (chunk_end - chunk_start) * SIZE;
+                std::vector<workfunction<SIZE>> children(slots);
+                std::vector<uint64_t> child_hashes(slots);
+                adjacencies_by_hash.resize(chunk_end);
+                min_update_costs_vec.resize(chunk_end);
+                if constexpr (EXACT_WORKFUNCTION_KEYS) {
+                    adjacencies_by_index.resize(chunk_end);
+                    exact_claims.resize(slots);
+                }
+                if (canonical) {
+                    relabelings_vec.resize(chunk_end);
+                }
+
+#pragma omp parallel for schedule(dynamic, 64)
+                for (uint64_t i = chunk_start; i < chunk_end; i++) {
+                    for (short req = 0; req < SIZE; req++) {
+                        const uint64_t slot = (i - chunk_start) * SIZE + req;
+                        workfunction<SIZE>& new_wf = children[slot];
+                        new_wf = reachable_wfs_vec[i];
+                        flat_update(&new_wf, req);
+                        min_update_costs_vec[i][req] = new_wf.min();
+                        cut_minimum(&new_wf);
+                        dynamic_update(&new_wf);
+                        if (canonical) {
+                            uint64_t relabeling = canonical_relabeling(&new_wf);
+                            new_wf = right_composition(&new_wf, relabeling);
+                            relabelings_vec[i][req] = relabeling;
+                        }
+
+                        uint64_t h = hash(&new_wf);
+                        child_hashes[slot] = h;
+                        adjacencies_by_hash[i][req] = h;
+                        if constexpr (EXACT_WORKFUNCTION_KEYS) {
+                            const typename exact_table::record r = exact_table::pack(new_wf);
+                            exact_claims.store(slot, r);
+                            if (exact_index.find(h, r) == exact_table::NOT_FOUND) {
+                                exact_claims.insert_min(h, slot);
+                            }
+                        } else if (!discovered.contains(h)) {
+                            claims.insert_min(h, slot);
+                        }
+                    }
+                }
+
+                // Exactly the first occurrence of each new hash (or work function) gets a new index.
+                std::vector<uint64_t> new_offsets(slots + 1, 0);
+#pragma omp parallel for
+                for (uint64_t slot = 0; slot < slots; slot++) {
+                    uint64_t h = child_hashes[slot];
+                    if constexpr (EXACT_WORKFUNCTION_KEYS) {
+                        const typename exact_table::record r = exact_claims.at(slot);
+                        if (exact_index.find(h, r) == exact_table::NOT_FOUND && exact_claims.find(h, r) == slot) {
+                            new_offsets[slot + 1] = 1;
+                        }
+                    } else if (!discovered.contains(h) && claims.at(h) == slot) {
+                        new_offsets[slot + 1] = 1;
+                    }
+                }
+                for (uint64_t slot = 0; slot < slots; slot++) {
+                    new_offsets[slot + 1] += new_offsets[slot];
+                }
+
+                const uint64_t first_new_index = reachable_wfs_vec.size();
+                reachable_wfs_vec.resize(first_new_index + new_offsets[slots]);
+                if constexpr (EXACT_WORKFUNCTION_KEYS) {
+                    exact_index.resize(reachable_wfs_vec.size());
+                }
+#pragma omp parallel for
+                for (uint64_t slot = 0; slot < slots; slot++) {
+                    if (new_offsets[slot + 1] != new_offsets[slot]) {
+                        const uint64_t new_index = first_new_index + new_offsets[slot];
+                        reachable_wfs_vec[new_index] = children[slot];
+                        if constexpr (EXACT_WORKFUNCTION_KEYS) {
+                            exact_index.store(new_index, exact_claims.at(slot));
+                            exact_index.insert(child_hashes[slot], new_index);
+                        } else {
+                            discovered.insert(child_hashes[slot], new_index);
+                        }
+                    }
+                }
+
+                // The hashes alone do not identify the children, so their indices are found now.
+                if constexpr (EXACT_WORKFUNCTION_KEYS) {
+#pragma omp parallel for
+                    for (uint64_t slot = 0; slot < slots; slot++) {
+                        adjacencies_by_index[chunk_start + slot / SIZE][slot % SIZE] =
+                            exact_index.find(child_hashes[slot], exact_claims.at(slot));
+                    }
+                }
+                claims.clear();
+                exact_claims.clear();
+            }
+
+            fprintf(stderr, "Level %" PRIu64 ": %" PRIu64 " work functions, %zu reachable in total.\n",
+                    level, level_end - level_start, reachable_wfs_vec.size());
+            level_start = level_end;
+            level++;
+        }
+
+        reachable_workfunctions = reachable_wfs_vec.size();
+        reachable_wfs_arr = new workfunction<SIZE>[reachable_workfunctions];
+        min_update_costs_arr = new std::array<short, SIZE>[reachable_workfunctions];
+        adjacent_functions_arr = new std::array<unsigned int, SIZE>[reachable_workfunctions];
+
+#pragma omp parallel for
+        for (uint64_t i = 0; i < reachable_workfunctions; i++) {
+            reachable_wfs_arr[i] = reachable_wfs_vec[i];
+            min_update_costs_arr[i] = min_update_costs_vec[i];
+            for (int j = 0; j < SIZE; j++) {
+                adjacent_functions_arr[i][j] = EXACT_WORKFUNCTION_KEYS ? adjacencies_by_index[i][j]
+                                                                       : discovered.at(adjacencies_by_hash[i][j]);
+            }
+        }
+        if (canonical) {
+            adjacent_relabelings_arr = new std::array<unsigned int, SIZE>[reachable_workfunctions];
+            std::copy(relabelings_vec.begin(), relabelings_vec.end(), adjacent_relabelings_arr);
+            fprintf(stderr, "Canonical orbits: %" PRIu64 " representatives.\n", reachable_workfunctions);
+        }
+
+        hash_to_index.clear();
+        if constexpr (EXACT_WORKFUNCTION_KEYS) {
+            report_exact_index();
+            return;
+        }
+        for (const auto& shard : discovered.shards) {
+            for (const auto& [h, index] : shard.map) {
+                hash_to_index[h] = index;
+            }
+        }
+    }
+
+    // The original single-threaded BFS. Kept as a reference for initialize_reachable_from_scratch().
+    void initialize_reachable_from_scratch_sequential() {
+        assert(!canonical);
         std::vector<workfunction<SIZE>> reachable_wfs_vec;
 
         std::unordered_set<uint64_t> reachable_hashes;
@@ -341,7 +760,7 @@ public:
         std::vector<std::array<uint64_t, SIZE>> adjacencies_by_hash;
         std::vector<std::array<short, SIZE>> min_update_costs_vec;
 
-        workfunction<SIZE> initial = *invs;
+        workfunction<SIZE> initial = *inversion_wf<SIZE>;
         std::queue<workfunction<SIZE>> q;
         reachable_hashes.insert(hash(&initial));
         q.push(initial);
@@ -392,6 +811,9 @@ public:
 
             adjacent_functions_arr[i] = adj_by_index;
         }
+        if constexpr (EXACT_WORKFUNCTION_KEYS) {
+            fill_hash_to_index();
+        }
     }
 
 
@@ -0,0 +1,133 @@
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include "permutation_graph.hpp"
+#include "wf_manager.hpp"
+#include "workfunction.hpp"
+#include "pairwise_wf_manager.hpp"
+
+// Checks that the parallel BFS over the reachable work functions (and over the pairwise states) produces
+// the same arrays as the sequential one, and that all versions of dynamic_update() agree
+// on every reachable work function under every request.
+
+template <int SIZE> bool same_reachable(const wf_manager<SIZE>& a, const wf_manager<SIZE>& b) {
+    if (a.reachable_workfunctions != b.reachable_workfunctions) {
+        return false;
+    }
+    const uint64_t n = a.reachable_workfunctions;
+    for (uint64_t i = 0; i < n; i++) {
+        if (a.index_of(&a.reachable_wfs_arr[i]) != i || b.index_of(&a.reachable_wfs_arr[i]) != i) {
+            return false;
+        }
+    }
+    return memcmp(a.reachable_wfs_arr, b.reachable_wfs_arr, n * sizeof(workfunction<SIZE>)) == 0 &&
+           memcmp(a.adjacent_functions_arr, b.adjacent_functions_arr, n * sizeof(std::array<unsigned int, SIZE>)) == 0 &&
+           memcmp(a.min_update_costs_arr, b.min_update_costs_arr, n * sizeof(std::array<short, SIZE>)) == 0;
+}
+
+// Stores the reachable work functions under only four distinct hashes, so nearly all of them collide,
+// and checks that each one is still found at its own index.
+template <int SIZE> bool exact_keys_under_collisions(const wf_manager<SIZE>& wm) {
+    using exact_table = exact_wf_table<SIZE>;
+    exact_table table;
+    const uint64_t n = wm.reachable_workfunctions;
+    table.resize(n);
+#pragma omp parallel for
+    for (uint64_t i = 0; i < n; i++) {
+        table.store(i, exact_table::pack(wm.reachable_wfs_arr[i]));
+        table.insert((i % 4) << 62, i);
+    }
+    uint64_t mismatches = 0;
+    for (uint64_t i = 0; i < n; i++) {
+        mismatches += table.find((i % 4) << 62, exact_table::pack(wm.reachable_wfs_arr[i])) != i;
+    }
+    fprintf(stderr, "Exact keys: %" PRIu64 " hash collisions, %" PRIu64 " mismatches.\n",
+            table.collisions.load(), mismatches);
+    return mismatches == 0;
+}
+
+template <int SIZE> bool same_pairwise_reachable(const pairwise_wf_manager<SIZE>& a,
+                                                 const pairwise_wf_manager<SIZE>& b) {
+    if (a.reachable_workfunctions != b.reachable_workfunctions) {
+        return false;
+    }
+    const uint64_t n = a.reachable_workfunctions;
+    return memcmp(a.reachable_wfs_arr, b.reachable_wfs_arr, n * sizeof(algorithm_against_pairwise_opt<SIZE>)) == 0 &&
+           memcmp(a.adjacent_functions_arr, b.adjacent_functions_arr, n * sizeof(std::array<unsigned int, SIZE>)) == 0 &&
+           memcmp(a.update_costs_arr, b.update_costs_arr, n * sizeof(std::array<short, SIZE>)) == 0 &&
+           a.index_of_code == b.index_of_code;
+}
+
+template <int SIZE> bool compare_dynamic_updates(wf_manager<SIZE>& wm) {
+    using closure = void (*)(workfunction<SIZE>*);
+    const std::array<std::pair<const char*, closure>, 3> versions{{
+        {"quadratic", wf_manager<SIZE>::dynamic_update_quadratic},
+        {"buckets", wf_manager<SIZE>::dynamic_update_buckets},
+        {"simd", wf_manager<SIZE>::dynamic_update_simd},
+    }};
+
+    std::vector<workfunction<SIZE>> inputs;
+    for (uint64_t i = 0; i < wm.reachable_workfunctions; i++) {
+        for (short req = 0; req < SIZE; req++) {
+            workfunction<SIZE> new_wf = wm.reachable_wfs_arr[i];
+            wm.flat_update(&new_wf, req);
+            wm.cut_minimum(&new_wf);
+            inputs.push_back(new_wf);
+        }
+    }
+
+    std::array<std::vector<workfunction<SIZE>>, versions.size()> outputs;
+    for (int v = 0; v < versions.size(); v++) {
+        outputs[v] = inputs;
+        auto start = std::chrono::steady_clock::now();
+        for (auto& out : outputs[v]) {
+            versions[v].second(&out);
+        }
+        auto end = std::chrono::steady_clock::now();
+        fprintf(stderr, "dynamic_update %s: %zu work functions in %.2f ms.\n", versions[v].first, inputs.size(),
+                std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    uint64_t mismatches = 0;
+    for (int v = 1; v < versions.size(); v++) {
+        for (uint64_t i = 0; i < inputs.size(); i++) {
+            if (outputs[v][i].vals != outputs[0][i].vals) {
+                mismatches++;
+            }
+        }
+    }
+    fprintf(stderr, "dynamic_update: %" PRIu64 " mismatches.\n", mismatches);
+    return mismatches == 0;
+}
+
+int main(void) {
+    pg = new permutation_graph<LISTSIZE>();
+    pg->init();
+    invs = new workfunction<LISTSIZE>{};
+    wf_manager<LISTSIZE>::initialize_inversions();
+
+    wf_manager<TESTSIZE> sequential(*pg);
+    sequential.initialize_reachable_from_scratch_sequential();
+    wf_manager<TESTSIZE> parallel(*pg);
+    // Both managers need the same Zobrist keys.
+    *parallel.zobrist = *sequential.zobrist;
+    parallel.initialize_reachable_from_scratch();
+
+    bool ok = same_reachable<TESTSIZE>(sequential, parallel);
+    fprintf(stderr, "Sequential BFS: %" PRIu64 " work functions, parallel BFS: %" PRIu64 " work functions, %s.\n",
+            sequential.reachable_workfunctions, parallel.reachable_workfunctions, ok ? "identical" : "DIFFERENT");
+    ok &= compare_dynamic_updates<TESTSIZE>(parallel);
+    ok &= exact_keys_under_collisions<TESTSIZE>(parallel);
+
+    pairwise_wf_manager<TESTSIZE> pairwise_sequential;
+    pairwise_sequential.initialize_reachable_from_scratch_sequential();
+    pairwise_wf_manager<TESTSIZE> pairwise_parallel;
+    pairwise_parallel.initialize_reachable_from_scratch();
+    bool pairwise_ok = same_pairwise_reachable<TESTSIZE>(pairwise_sequential, pairwise_parallel);
+    fprintf(stderr, "Sequential pairwise BFS: %" PRIu64 " states, parallel: %" PRIu64 " states, %s.\n",
+            pairwise_sequential.reachable_workfunctions, pairwise_parallel.reachable_workfunctions,
+            pairwise_ok ? "identical" : "DIFFERENT");
+    ok &= pairwise_ok;
+    return ok ? 0 : 1;
+}
@@ -88,5 +88,10 @@ public:
     }
 };
 
-workfunction<TESTSIZE> *invs = nullptr;
-bool inversions_ready = false;
\ No newline at end of file
+// The work function of the inversion counts, one per list size, filled in by wf_manager::initialize_inversions().
+template <int SIZE> workfunction<SIZE> *inversion_wf = nullptr;
+template <int SIZE> bool inversions_ready_for = false;
+
+// The instances for the list size the program was compiled for.
+workfunction<TESTSIZE> *&invs = inversion_wf<TESTSIZE>;
+bool &inversions_ready = inversions_ready_for<TESTSIZE>;
\ No newline at end of file